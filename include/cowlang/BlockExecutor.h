@@ -0,0 +1,99 @@
+#pragma once
+
+#include <exception>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ExecutionContext.h"
+#include "PersistableDictionary.h"
+#include "Program.h"
+
+namespace cow
+{
+
+/**
+ * Executes the transactions of a block against the storages of their contracts
+ *
+ * All transactions are first executed speculatively on worker threads, against the storages as
+ * they were before the block, while their storages record which keys they read and write. An
+ * execution only copies the keys it accesses out of the shared storages. Then the transactions
+ * are committed in block order. A transaction that read a key an earlier transaction of the block
+ * wrote is executed again, against the storage as it is at that point. The balance of a contract
+ * is treated like a key of its storage: transactions run with the balance the committed ones
+ * left, and one that looked at the balance after an earlier one changed it is executed again.
+ * Hence, the storages, balances, contexts and results end up exactly as if the transactions were
+ * executed one after the other.
+ */
+class BlockExecutor
+{
+public:
+    struct Transaction
+    {
+        ProgramPtr program;
+        std::string storage; // name of the storage of the contract, usually its address
+        std::string data;    // call data
+        uint32_t execution_step_limit = 0;
+
+        // afterwards holds what the transaction sent and the remaining contract balance, the output
+        // is only passed on once the transaction was committed. The contract balance it holds
+        // before is ignored, unless it is the first transaction of the contract, see balance()
+        ExecutionContext context;
+    };
+
+    struct Result
+    {
+        uint32_t num_execution_steps = 0;
+        // why the transaction failed, if it did. Unless it suicided, it left the storage unchanged
+        std::exception_ptr error;
+        bool reexecuted = false;  // conflicted with an earlier transaction of the block
+    };
+
+    /**
+     * @param num_threads
+     *      Number of worker threads for the speculative executions
+     */
+    BlockExecutor(size_t num_threads = 0);
+
+    /**
+     * The storage called name, it is empty until set or written by a transaction
+     */
+    StorageState &storage(const std::string &name) { return m_storages[name]; }
+
+    /**
+     * The balance of the contract with the storage called name
+     *
+     * Until set, it is taken from the context of the first transaction of the contract. Committed
+     * transactions update it.
+     */
+    uint64_t &balance(const std::string &name) { return m_balances[name]; }
+
+    std::vector<Result> execute(std::vector<Transaction> &transactions);
+
+private:
+    struct Execution
+    {
+        Result result;
+        ExecutionContext context;
+        std::string output;
+        std::set<std::string> reads;
+        std::set<std::string> writes;
+        StorageState written; // the values of the keys in writes
+        bool reads_balance = false;
+        bool writes_balance = false;
+    };
+
+    static void run(const Transaction &transaction,
+                    const StorageState &storage,
+                    uint64_t balance,
+                    Execution &execution);
+
+    void commit(Transaction &transaction, Execution &execution);
+
+    size_t m_num_threads;
+    std::map<std::string, StorageState> m_storages;
+    std::map<std::string, uint64_t> m_balances;
+};
+
+} // namespace cow
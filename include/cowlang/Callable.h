@@ -16,6 +16,15 @@ public:
     call(const std::vector<ValuePtr> &arg, Scope &scope, uint32_t &current_num, uint32_t &current_max) = 0;
 
     bool is_callable() const override { return true; }
+
+    /**
+     * Whether the steps a call charges count for the caller
+     *
+     * VM functions are limited separately, so the steps they take are not charged to the caller.
+     * They are the only callables that return false, the interpreter calls them in a frame of
+     * its own instead of through call().
+     */
+    virtual bool keeps_steps() const { return true; }
 };
 
 } // namespace cow
@@ -31,7 +31,6 @@ public:
         ValuePtr returnval = nullptr;
         // call with own context
         Scope body_scope(memory_manager(), scope);
-        body_scope.require_global();
 
         // set default values to the args first
         uint32_t minimum_arguments = m_args.size();
@@ -17,31 +17,53 @@ class CallableVMFunction : public Callable
 {
 public:
     CallableVMFunction(MemoryManager &mem,
-                       bitstream &begin_jump,
-                       std::vector<std::string> &args,
-                       std::vector<ValuePtr> &defaults)
-    : Callable(mem), m_begin_jump(std::move(begin_jump)), m_args(args), m_defaults(defaults)
+                       ProgramPtr program,
+                       const FunctionCode &code,
+                       std::vector<ValuePtr> defaults)
+    : Callable(mem), m_program(std::move(program)), m_code(code), m_defaults(std::move(defaults))
     {
     }
 
     ValuePtr duplicate(MemoryManager &mem) override
     {
-        return wrap_value(new(mem) CallableVMFunction(mem, m_begin_jump, m_args, m_defaults));
+        return wrap_value(new(mem) CallableVMFunction(mem, m_program, m_code, m_defaults));
     }
 
+    /**
+     * Calls from outside of an interpreter run the body in an interpreter of their own. The
+     * interpreter that defined the function runs it in a frame of its own instead.
+     */
     ValuePtr call(const std::vector<ValuePtr> &args, Scope &scope, uint32_t &current_num, uint32_t &current_max) override
     {
         ValuePtr returnval = nullptr;
         // call with own context
-        Scope body_scope(memory_manager(), scope);
-        body_scope.require_global();
-        Interpreter pyint(m_begin_jump, memory_manager()); // borrow the scope of the parent interpreter
+        Scope body_scope(memory_manager(), scope, m_program, m_code.frame);
+        Interpreter pyint(m_program, m_code.entry, memory_manager()); // borrow the scope of the parent interpreter
         pyint.set_execution_step_limit(current_max);
         pyint.set_num_execution_steps(current_num);
 
-        // set default values to the args first
+        bind_arguments(body_scope, args);
+
+        try
+        {
+            returnval = pyint.execute_in_scope(body_scope);
+        }
+        catch(...)
+        {
+            current_num = pyint.num_execution_steps();
+            throw;
+        }
+        current_num = pyint.num_execution_steps();
+        return returnval;
+    }
+
+    /**
+     * Set the parameters in the scope of the body: defaults first, then the arguments
+     */
+    void bind_arguments(Scope &body_scope, const std::vector<ValuePtr> &args) const
+    {
         uint32_t minimum_arguments = 0;
-        uint32_t maximum_arguments = m_args.size();
+        uint32_t maximum_arguments = m_code.params.size();
 
         if(args.size() > maximum_arguments)
         {
@@ -52,7 +74,7 @@ public:
         for(size_t i = 0; i < maximum_arguments; ++i)
         {
             if(m_defaults[i] != nullptr)
-                body_scope.set_value(m_args[i], m_defaults[i]);
+                body_scope.set_value(m_code.params[i], m_defaults[i]);
             else
             {
                 minimum_arguments++; // this argument must be provided as it has no def. value
@@ -67,28 +89,23 @@ public:
 
         for(size_t i = 0; i < args.size(); ++i)
         {
-            body_scope.set_value(m_args[i], args[i]);
+            body_scope.set_value(m_code.params[i], args[i]);
         }
-
-
-        try
-        {
-            returnval = pyint.execute_in_scope(body_scope);
-        }
-        catch(...)
-        {
-            current_num = pyint.num_execution_steps();
-            throw;
-        }
-        current_num = pyint.num_execution_steps();
-        return returnval;
     }
 
+    const ProgramPtr &program() const { return m_program; }
+    const FunctionCode &code() const { return m_code; }
+    const std::vector<ValuePtr> &defaults() const { return m_defaults; }
+    uint32_t entry() const { return m_code.entry; }
+    uint32_t frame() const { return m_code.frame; }
+
     ValueType type() const override { return ValueType::Function; }
 
+    bool keeps_steps() const override { return false; }
+
 private:
-    bitstream m_begin_jump;
-    std::vector<std::string> m_args;
+    ProgramPtr m_program; // keeps m_code alive
+    const FunctionCode &m_code;
     std::vector<ValuePtr> m_defaults;
 };
 
@@ -4,12 +4,13 @@
 #include "InterpreterTypes.h"
 #include "Iterator.h"
 #include "Scope.h"
+#include "SegmentedArray.h"
 #include "Value.h"
 namespace cow
 {
 
 class Dictionary;
-typedef std::shared_ptr<Dictionary> DictionaryPtr;
+typedef ObjectPtr<Dictionary> DictionaryPtr;
 
 class DictItemIterator : public Generator
 {
@@ -22,7 +23,7 @@ public:
 
 private:
     Dictionary &m_dict;
-    std::map<std::string, ValuePtr>::iterator m_it;
+    uint32_t m_pos;
 };
 
 class DictItems : public Callable // public IterateableValue, public Callable
@@ -50,7 +51,7 @@ private:
     Dictionary &m_dict;
 };
 
-typedef std::shared_ptr<DictItems> DictItemsPtr;
+typedef ObjectPtr<DictItems> DictItemsPtr;
 
 class DictKeyIterator : public Generator
 {
@@ -63,13 +64,22 @@ public:
 
 private:
     Dictionary &m_dict;
-    std::map<std::string, ValuePtr>::iterator m_it;
+    uint32_t m_pos;
 };
 
+/**
+ * Dictionary that keeps its elements in insertion order, like Python's
+ *
+ * Entries are appended to a dense array, a sparse index of open-addressed slots maps the hashes
+ * of the keys to positions in that array. Both, and the keys themselves, are allocated by the
+ * memory manager of the dictionary. Keys are hashed with a secret key, so a contract cannot choose keys that collide
+ * and make every lookup probe the whole index, while it pays for a single one.
+ */
 class Dictionary : public IterateableValue
 {
 public:
-    Dictionary(MemoryManager &mem) : IterateableValue(mem) {}
+    Dictionary(MemoryManager &mem) : IterateableValue(mem), m_entries(mem), m_index(mem) {}
+    ~Dictionary();
 
     IteratorPtr iterate() override;
 
@@ -98,12 +108,42 @@ public:
 
     ValuePtr duplicate(MemoryManager &mem) override;
 
-    std::map<std::string, ValuePtr> &elements();
-
-    const std::map<std::string, ValuePtr> &elements() const;
+    /**
+     * Key and value of the element at pos, in insertion order
+     */
+    std::string key(uint32_t pos) const
+    {
+        return std::string(m_entries[pos].key, m_entries[pos].key_size);
+    }
+    const ValuePtr &value(uint32_t pos) const { return m_entries[pos].value; }
 
 private:
-    std::map<std::string, ValuePtr> m_elements;
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr size_t MIN_INDEX_SIZE = 8;
+
+    struct Entry
+    {
+        size_t hash;
+        char *key; // nullptr if the key is empty
+        uint32_t key_size;
+        ValuePtr value;
+    };
+
+    /**
+     * SipHash of key, under a random key of the process
+     */
+    static size_t key_hash(const std::string &key);
+
+    /**
+     * The slot of key in the index, or the empty slot it would go to
+     */
+    size_t find_slot(const std::string &key, size_t hash) const;
+
+    void grow_index();
+
+    SegmentedArray<Entry> m_entries;
+    SegmentedArray<uint32_t> m_index; // positions in m_entries, the size is a power of two
+    uint32_t m_size = 0;
 };
 
 } // namespace cow
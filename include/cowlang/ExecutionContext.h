@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+#include "Object.h"
+
+extern void print_program_output(const std::string &str);
+
+namespace cow
+{
+
+enum class net_type
+{
+    MAIN,
+    TEST,
+    REGTEST
+};
+
+/**
+ * Everything an execution needs to know about its environment
+ *
+ * Each execution gets a context of its own, so executions on different threads don't share any
+ * state. The blockchain fields default to hardcoded values for easy testing.
+ */
+struct ExecutionContext
+{
+    /**
+     * The context of interpreters that were not given one
+     *
+     * @note It is shared by the whole process, so it must not be used by concurrent executions
+     */
+    static ExecutionContext &global();
+
+    // the transaction and the chain it is executed on
+    net_type net = net_type::MAIN;
+    std::string txid = "a1075db55d416d3ca199f55b6084e2115b9345e16c5cf302fc80e9d5fbf5d48d";
+    std::string current_block = "00000000000000000015c23c0979270b91c26a562ae62463b85481f1d945bc21";
+    std::string previous_block = "0000000000000000002f3cb3939d8685c8976dc9e35ccec08c4e121b12688974";
+    uint32_t current_time = 1546659311;
+    uint32_t current_height = 1234567;
+    uint32_t previous_time = 1546659307;
+    std::string sender = "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa";
+    std::string contract_address = "1XPTgDRhN8RFnzniWCddobD9iKZatrvH4";
+    uint64_t value = 50 * 100000000ULL;
+    uint64_t contract_balance = 300 * 100000000ULL;
+
+    // what the contract sent (or left when it suicided) to which address
+    std::map<std::string, uint64_t> send_map;
+
+    // set once the contract looked at or changed its balance
+    bool balance_accessed = false;
+
+    // activates interactive features of the shell
+    bool devmode = false;
+    bool contractmode = false; // special flag if using the "contract interaction shell"
+
+    // heap limit for the memory managers of executions set up by the host
+    size_t max_heap_pages = DEFAULT_MAXIMUM_HEAP_PAGES;
+
+    // receives what the program prints
+    std::function<void(const std::string &)> output = print_program_output;
+};
+
+} // namespace cow
@@ -3,16 +3,17 @@
 #include <string>
 
 #include "Dictionary.h"
+#include "ExecutionContext.h"
 #include "Module.h"
 #include "NodeType.h"
 #include "PersistableDictionary.h"
+#include "Program.h"
 #include "Scope.h"
+#include "Snapshot.h"
 #include "Tuple.h"
 #include "Value.h"
 
 #include "execution_limits.h"
-extern bool devmode;
-extern bool contractmode;
 
 #define ASSERT_LEFT_AND_RIGHT               \
     if(left == nullptr || right == nullptr) \
@@ -36,6 +37,8 @@ extern bool contractmode;
 namespace cow
 {
 
+class CallableVMFunction;
+
 /**
  * Main class that takes care of running (=interpreting) the compiled code
  */
@@ -46,18 +49,42 @@ public:
      * Construct the Python interpreter
      *
      * @param data
-     *      The compiled syntax tree of the program
+     *      The compiled syntax tree of the program. A view is decoded in place and doesn't
+     *      need to outlive the constructor.
      */
     Interpreter(const bitstream &data, MemoryManager &mem);
+    Interpreter(bitstream_view data, MemoryManager &mem);
     Interpreter(const bitstream &data, MemoryManager &mem, Interpreter &scope_borrower);
+
+    /**
+     * Construct an interpreter that starts executing an already decoded program at entry
+     */
+    Interpreter(ProgramPtr program, uint32_t entry, MemoryManager &mem);
     ~Interpreter();
 
     void re_assign_bitstream(const bitstream &data);
+    void re_assign_bitstream(bitstream_view data);
     ValuePtr execute();
     ValuePtr execute_in_scope(Scope &scope);
     ValuePtr calldata(std::string &data);
+
+    /**
+     * Capture the globals that the top level code created during the last execute()
+     *
+     * @return nullptr if the top level code failed or did more than define functions and
+     *         import modules
+     */
+    SnapshotPtr snapshot() const;
+
+    /**
+     * Set up the globals from a snapshot of this program instead of calling execute()
+     *
+     * The steps the top level code took are charged again. Modules that were registered
+     * when the snapshot was taken have to be registered before.
+     */
+    void restore(SnapshotPtr snapshot);
     Scope &get_scope() { return *m_global_scope; };
-    std::shared_ptr<PersistableDictionary> get_storage_pointer() { return store; }
+    PersistableDictionaryPtr get_storage_pointer() { return store; }
 
     void set_value(const std::string &name, ValuePtr value);
 
@@ -75,6 +102,14 @@ public:
 
     MemoryManager &memory_manager() { return m_mem; }
 
+    /**
+     * Run in the environment of context instead of the global one
+     *
+     * Concurrent executions each need a context of their own. It has to outlive the interpreter.
+     */
+    void set_context(ExecutionContext &context);
+    ExecutionContext &context() { return m_global_scope->context(); }
+
 private:
     enum class LoopState
     {
@@ -86,16 +121,34 @@ private:
         IgnoreAll
     };
 
+    // where to continue once the function that is currently running returns
+    struct Frame
+    {
+        ProgramPtr program;
+        uint32_t pc;
+    };
+
     ModulePtr get_module(const std::string &name);
 
+    ValuePtr call_value(const ValuePtr &callable, const std::vector<ValuePtr> &args, Scope &scope);
+    ValuePtr call_function(const CallableVMFunction &function, const std::vector<ValuePtr> &args, Scope &scope);
+    void pop_frame();
+
     ValuePtr execute_next(Scope &scope, LoopState &loop_state);
     void skip_next();
+    void charge(uint32_t steps);
 
     void load_from_module(Scope &scope, const std::string &module, const std::string &name, const std::string &as_name);
     void load_module(Scope &scope, const std::string &name, const std::string &as_name);
-    ValuePtr read_function_stub(Interpreter &i);
-    std::string read_name();
-    std::vector<std::string> read_names();
+    void record_import(Scope &scope,
+                       Snapshot::Definition::Kind kind,
+                       const std::string &module,
+                       const std::string &member,
+                       const std::string &as_name);
+    ValuePtr read_function_stub(Interpreter &i, const Instruction &def);
+    const std::string &read_name();
+    Symbol read_symbol();
+    uint32_t read_symbols(Symbol symbols[2]);
 
     MemoryManager &m_mem;
     bool do_not_free_scope;
@@ -106,9 +159,22 @@ private:
 
     uint32_t m_num_execution_steps;
     uint32_t m_execution_step_limit;
-    bitstream m_data;
 
-    std::shared_ptr<PersistableDictionary> store;
+    ProgramPtr m_program;
+    uint32_t m_pc;
+
+    // callers of the functions that are running
+    std::vector<Frame> m_frames;
+
+    // what the top level code bound to globals, and whether that is all it did
+    std::vector<Snapshot::Definition> m_definitions;
+    bool m_definitions_only = false;
+    bool m_initialized = false;
+    uint32_t m_top_level_steps = 0;
+
+    SnapshotPtr m_snapshot; // keeps the restored functions alive
+
+    PersistableDictionaryPtr store;
 };
 
 inline void Interpreter::set_value(const std::string &name, ValuePtr value)
@@ -27,6 +27,33 @@ enum class ValueType
     Custom
 };
 
+/**
+ * Names the interpreter resolves itself. They always refer to the builtin, even if a variable
+ * of the same name exists, except for those from Sum on: they were added later, so variables
+ * of existing contracts that use these names take precedence.
+ */
+enum class BuiltinName
+{
+    NotBuiltin,
+    None,
+    True,
+    False,
+    Range,
+    MakeInt,
+    MakeString,
+    Print,
+    Length,
+    Min,
+    Max,
+    Sum,
+    Sorted,
+    Any,
+    All,
+    Enumerate,
+    Zip,
+    Abs
+};
+
 enum class CompareOpType
 {
     Undefined,
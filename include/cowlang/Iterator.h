@@ -24,7 +24,7 @@ protected:
     using Value::Value;
 };
 
-typedef std::shared_ptr<Iterator> IteratorPtr;
+typedef ObjectPtr<Iterator> IteratorPtr;
 
 class Generator : public Iterator
 {
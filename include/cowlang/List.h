@@ -2,11 +2,12 @@
 
 #include "InterpreterTypes.h"
 #include "Iterator.h"
+#include "SegmentedArray.h"
 namespace cow
 {
 
 class List;
-typedef std::shared_ptr<List> ListPtr;
+typedef ObjectPtr<List> ListPtr;
 
 class ListIterator : public Generator
 {
@@ -22,10 +23,27 @@ private:
     uint32_t m_pos;
 };
 
+/**
+ * Python list
+ *
+ * As long as all elements are integers, or all are floats, they are stored unboxed in a
+ * contiguous array. Value objects are only created for the elements that get read. Storing any
+ * other kind of value converts the list to boxed storage for good. Either way the elements are
+ * allocated by the memory manager of the list.
+ */
 class List : public IterateableValue
 {
 public:
-    List(MemoryManager &mem) : IterateableValue(mem) {}
+    List(MemoryManager &mem) : IterateableValue(mem), m_boxed(mem), m_integers(mem), m_floats(mem)
+    {
+    }
+
+    /**
+     * List of the given integers, stored unboxed
+     */
+    List(MemoryManager &mem, const std::vector<int64_t> &integers);
+
+    ~List();
 
     IteratorPtr iterate() override;
 
@@ -49,10 +67,31 @@ public:
 
     void append(ValuePtr val);
 
-    const std::vector<ValuePtr> &elements() const;
+    /**
+     * The elements if the list holds only integers, nullptr otherwise
+     */
+    const SegmentedArray<int64_t> *integers() const;
 
 private:
-    std::vector<ValuePtr> m_elements;
+    enum class Storage
+    {
+        Boxed,
+        Integers,
+        Floats
+    };
+
+    /**
+     * Switch to boxed storage, unless it already is
+     */
+    void box();
+
+    // integers and floats are unboxed, an empty list takes the storage of its first element
+    Storage m_storage = Storage::Boxed;
+    uint32_t m_size = 0;
+
+    SegmentedArray<ValuePtr> m_boxed;
+    SegmentedArray<int64_t> m_integers;
+    SegmentedArray<double> m_floats;
 };
 
 } // namespace cow
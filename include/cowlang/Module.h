@@ -8,7 +8,7 @@ namespace cow
 {
 
 class Module;
-typedef std::shared_ptr<Module> ModulePtr;
+typedef ObjectPtr<Module> ModulePtr;
 
 class Module : public Value
 {
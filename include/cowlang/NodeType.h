@@ -1,8 +1,20 @@
 #pragma once
 
+#include <stdint.h>
+
 namespace cow
 {
 
+/**
+ * Compiled programs start with the magic number and the format version, followed by the pool of
+ * names and string constants that the instructions refer to by index.
+ *
+ * Programs without the header are from before the pool was introduced and store their strings
+ * inline. They can still be loaded.
+ */
+constexpr uint32_t BYTECODE_MAGIC = 0x636f7721; // "cow!"
+constexpr uint32_t BYTECODE_VERSION = 2;
+
 enum class NodeType
 {
     Pass,
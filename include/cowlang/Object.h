@@ -1,7 +1,15 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <limits>
 #include <map>
-#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace json
@@ -22,14 +30,16 @@ class List;
 class BoolVal;
 class FloatVal;
 
-using ValuePtr = std::shared_ptr<Value>;
-using IntValPtr = std::shared_ptr<IntVal>;
-using DictionaryPtr = std::shared_ptr<Dictionary>;
-using ListPtr = std::shared_ptr<List>;
-using StringValPtr = std::shared_ptr<StringVal>;
-using TuplePtr = std::shared_ptr<Tuple>;
-using BoolValPtr = std::shared_ptr<BoolVal>;
-using FloatValPtr = std::shared_ptr<FloatVal>;
+template <typename T> class ObjectPtr;
+
+using ValuePtr = ObjectPtr<Value>;
+using IntValPtr = ObjectPtr<IntVal>;
+using DictionaryPtr = ObjectPtr<Dictionary>;
+using ListPtr = ObjectPtr<List>;
+using StringValPtr = ObjectPtr<StringVal>;
+using TuplePtr = ObjectPtr<Tuple>;
+using BoolValPtr = ObjectPtr<BoolVal>;
+using FloatValPtr = ObjectPtr<FloatVal>;
 
 // Default value for maximum heap memory size -> 512MB!
 // If a program tries to allocate more, it will throw an OutOfMemoryError
@@ -51,9 +61,15 @@ public:
     virtual const uint32_t get_max_mem() = 0;
     virtual const uint32_t get_mem() = 0;
 
-    IntValPtr create_integer(const int32_t value);
+    /**
+     * Small integers, booleans and None are immediates: they are preallocated and shared, so
+     * creating one neither allocates nor touches a reference count. Values are never modified
+     * in place for that reason.
+     */
+    IntValPtr create_integer(const int64_t value);
     DictionaryPtr create_dictionary();
     StringValPtr create_string(const std::string &str);
+    StringValPtr create_string(std::string &&str);
     TuplePtr create_tuple();
     ValuePtr create_from_document(const json::Document &doc);
     FloatValPtr create_float(const double &value);
@@ -62,13 +78,72 @@ public:
     ValuePtr create_none();
 };
 
+/**
+ * Process-wide pool of heap pages
+ *
+ * Memory managers check their pages out of the pool and return them when they are destroyed,
+ * so consecutive executions reuse memory that is already mapped. Pages are aligned to their
+ * size, so the page of an address is found by masking it. Thread-safe.
+ */
+class PagePool
+{
+public:
+    static constexpr size_t PAGE_SIZE = 1024 * 1024;
+
+    /**
+     * What to do with a page when it is returned
+     */
+    enum class Scrub
+    {
+        None,
+        Zero,  // executions never see data of previous ones
+        Poison // fill with a pattern that makes use of uninitialized memory stand out
+    };
+
+    static PagePool &instance();
+
+    uint8_t *acquire();
+    void release(uint8_t *page);
+
+    /**
+     * Allocate and fault in pages up front, so executions don't have to
+     */
+    void reserve(size_t num_pages);
+
+    void set_scrub(Scrub scrub);
+    Scrub scrub() const;
+
+    /**
+     * Pages returned while the pool holds this many are freed instead
+     */
+    void set_max_pages(size_t max_pages);
+
+    size_t size() const;
+
+private:
+    PagePool() = default;
+
+    mutable std::mutex m_mutex;
+    std::vector<uint8_t *> m_pages;
+    Scrub m_scrub = Scrub::None;
+    size_t m_max_pages = 64;
+};
+
+/**
+ * Memory manager that keeps all values in a bounded number of pages
+ *
+ * Allocations are rounded up to a size class. Freed blocks are kept in a free list per class
+ * and reused by the next allocation of that class, everything else is bump-allocated from the
+ * pages. Both malloc and free take constant time. A bitmap per page marks where the blocks in use
+ * start, so freeing anything else (including pointers into a block) is detected.
+ */
 class DefaultMemoryManager : public MemoryManager
 {
 public:
     DefaultMemoryManager();
     ~DefaultMemoryManager();
 
-    static constexpr size_t PAGE_SIZE = 1024 * 1024;
+    static constexpr size_t PAGE_SIZE = PagePool::PAGE_SIZE;
 
     void *malloc(size_t size) override;
     void free(void *ptr) override;
@@ -76,22 +151,60 @@ public:
     const uint32_t get_max_mem() override;
     const uint32_t get_mem() override;
 
-private:
-    void *assign_alloc(size_t page_no, size_t poffset, size_t size);
+    /**
+     * Limit the heap to max_pages (DEFAULT_MAXIMUM_HEAP_PAGES when the manager is created)
+     */
+    void set_max_pages(size_t max_pages) { m_max_pages = max_pages; }
 
-    std::vector<uint8_t *> m_buffers;
-    size_t m_buffer_pos;
+    /**
+     * Free everything at once, in time linear to the number of pages
+     *
+     * The pages are kept for the next execution, but only as many as the limit allows are used.
+     * The memory that was used is scrubbed like pages that are returned to the pool.
+     *
+     * @note Objects allocated before must not be used afterwards
+     */
+    void reset();
 
-    struct AllocInfo
+private:
+    // precedes every block, the payload starts right after it
+    struct BlockHeader
     {
-        size_t page;
-        size_t size;
+        uint32_t size_class;
+        uint32_t state;
     };
 
-    void resize(size_t new_size);
+    // classes of 8 byte steps up to 1kB, then powers of two up to a page
+    static constexpr size_t SMALL_CLASS_STEP = 8;
+    static constexpr size_t NUM_SMALL_CLASSES = 128;
+    static constexpr size_t NUM_SIZE_CLASSES = NUM_SMALL_CLASSES + 10;
+
+    static constexpr size_t BITMAP_WORDS_PER_PAGE = PAGE_SIZE / sizeof(BlockHeader) / 64;
+
+    static uint32_t size_class(size_t size);
+    static size_t class_size(uint32_t size_class);
+
+    void add_page();
+    void *bump_alloc(uint32_t size_class);
+    void *pop_free(uint32_t size_class);
+
+    /**
+     * Position of the bit for the block at ptr in m_block_starts, SIZE_MAX if ptr is not
+     * in one of the pages or not aligned like a block
+     */
+    size_t block_bit(const void *ptr) const;
+    void set_block_bit(size_t bit, bool value);
+
+    std::vector<uint8_t *> m_buffers;
+    std::unordered_map<const uint8_t *, size_t> m_page_numbers;
+
+    // one bit per header size of each page, set where a block that is in use starts
+    std::vector<uint64_t> m_block_starts;
+    size_t m_buffer_pos;
+    size_t m_max_pages;
 
-    // Needs to be ordered
-    std::map<intptr_t, AllocInfo> m_allocs;
+    // freed blocks of each class; a free block stores the next one in its payload
+    std::array<void *, NUM_SIZE_CLASSES> m_free_lists;
 };
 
 /**
@@ -113,6 +226,9 @@ class Object
 public:
     virtual ~Object() {}
 
+    Object(const Object &other) : m_mem(other.m_mem) {}
+    Object &operator=(const Object &other) = delete;
+
     static void *operator new(std::size_t sz, MemoryManager &mem_mgr)
     {
         auto ptr = mem_mgr.malloc(sz);
@@ -127,11 +243,134 @@ public:
 
     MemoryManager &memory_manager() { return m_mem; }
 
+    /**
+     * Immortal objects are shared by all executions, so they are never counted or freed
+     */
+    void make_immortal() { m_refs = IMMORTAL; }
 
 protected:
     Object(MemoryManager &mem) : m_mem(mem) {}
 
     MemoryManager &m_mem;
+
+private:
+    template <typename T> friend class ObjectPtr;
+
+    static constexpr uint32_t IMMORTAL = std::numeric_limits<uint32_t>::max();
+
+    void retain()
+    {
+        if(m_refs != IMMORTAL)
+        {
+            m_refs += 1;
+        }
+    }
+
+    void release()
+    {
+        if(m_refs != IMMORTAL && --m_refs == 0)
+        {
+            delete this;
+        }
+    }
+
+    uint32_t m_refs = 0;
 };
 
+/**
+ * Reference to an object that was allocated by a memory manager
+ *
+ * The reference count is part of the object, so it is accounted for by the memory manager and
+ * wrapping an object needs no further allocation. Counting is not atomic: an object only ever
+ * belongs to one execution.
+ */
+template <typename T> class ObjectPtr
+{
+public:
+    ObjectPtr() = default;
+    ObjectPtr(std::nullptr_t) {}
+
+    explicit ObjectPtr(T *ptr) : m_ptr(ptr)
+    {
+        if(m_ptr)
+        {
+            m_ptr->retain();
+        }
+    }
+
+    ObjectPtr(const ObjectPtr &other) : ObjectPtr(other.m_ptr) {}
+    ObjectPtr(ObjectPtr &&other) noexcept : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+    ObjectPtr(const ObjectPtr<U> &other) : ObjectPtr(other.get())
+    {
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+    ObjectPtr(ObjectPtr<U> &&other) noexcept : m_ptr(other.m_ptr)
+    {
+        other.m_ptr = nullptr;
+    }
+
+    ~ObjectPtr()
+    {
+        if(m_ptr)
+        {
+            m_ptr->release();
+        }
+    }
+
+    ObjectPtr &operator=(ObjectPtr other) noexcept
+    {
+        std::swap(m_ptr, other.m_ptr);
+        return *this;
+    }
+
+    void reset() { ObjectPtr().swap(*this); }
+    void swap(ObjectPtr &other) noexcept { std::swap(m_ptr, other.m_ptr); }
+
+    T *get() const { return m_ptr; }
+    T *operator->() const { return m_ptr; }
+    T &operator*() const { return *m_ptr; }
+
+    explicit operator bool() const { return m_ptr != nullptr; }
+
+private:
+    template <typename U> friend class ObjectPtr;
+
+    T *m_ptr = nullptr;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ObjectPtr<T> &first, const ObjectPtr<U> &second)
+{
+    return first.get() == second.get();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ObjectPtr<T> &first, const ObjectPtr<U> &second)
+{
+    return first.get() != second.get();
+}
+
+template <typename T> inline bool operator==(const ObjectPtr<T> &ptr, std::nullptr_t)
+{
+    return !ptr;
+}
+
+template <typename T> inline bool operator==(std::nullptr_t, const ObjectPtr<T> &ptr)
+{
+    return !ptr;
+}
+
+template <typename T> inline bool operator!=(const ObjectPtr<T> &ptr, std::nullptr_t)
+{
+    return static_cast<bool>(ptr);
+}
+
+template <typename T> inline bool operator!=(std::nullptr_t, const ObjectPtr<T> &ptr)
+{
+    return static_cast<bool>(ptr);
+}
+
 } // namespace cow
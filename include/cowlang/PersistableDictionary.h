@@ -1,5 +1,14 @@
 #pragma once
 
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
 #include "Callable.h"
 #include "Iterator.h"
 #include "Scope.h"
@@ -9,17 +18,66 @@
 namespace cow
 {
 
+/**
+ * A value a contract storage can hold
+ */
+typedef std::variant<std::string, int64_t, double, bool> StorageValue;
+
+/**
+ * The contents of a contract storage
+ *
+ * Keys are hashed, so every access is a single lookup. Keys are only sorted for encoding, which
+ * keeps encoded storages deterministic.
+ */
+struct StorageState
+{
+    /**
+     * Version of the binary storage format, it is the first byte of every encoded storage
+     *
+     * After that come the number of entries and the entries, sorted by key. An entry is the
+     * length-prefixed key, a type byte and the value of that type. Deltas use the same format,
+     * with entries of a deleted type for the keys that were removed.
+     */
+    static constexpr uint8_t ENCODING_VERSION = 1;
+
+    /**
+     * Make key hold the same value as in other, or nothing if other does not hold it
+     */
+    void copy_key(const StorageState &other, const std::string &key);
+
+    /**
+     * All keys that hold a value, sorted
+     */
+    std::set<std::string> keys() const;
+
+    /**
+     * Encode all keys in the binary storage format
+     */
+    std::string encode() const;
+
+    /**
+     * Encode only the given keys, the ones the storage does not hold as deleted
+     */
+    std::string encode(const std::set<std::string> &keys) const;
+
+    /**
+     * Apply an encoded storage or delta, keys that are not part of it stay as they are
+     *
+     * @throws std::runtime_error if the data is malformed, entries before the error are applied
+     */
+    void decode(const std::string &data);
+
+    std::unordered_map<std::string, StorageValue> m_elements;
+};
+
+class StorageBackend;
 class PersistableDictionary;
-typedef std::shared_ptr<PersistableDictionary> PersistableDictionaryPtr;
+typedef ObjectPtr<PersistableDictionary> PersistableDictionaryPtr;
 
-class PersistableDictionary : public Value
+class PersistableDictionary : public Value, public StorageState
 {
 public:
     PersistableDictionary(MemoryManager &mem) : Value(mem) {}
-    static void operator delete(void *ptr)
-    {
-        // this object is not on memorymanager's heap
-    }
     ValuePtr get(const std::string &key);
     void insert(const std::string &key, ValuePtr value);
     void apply(const std::string &key, ValuePtr value, BinaryOpType op);
@@ -33,11 +91,108 @@ public:
         throw std::runtime_error("Persistent dictionaries cannot be copied.");
     }
 
+    /**
+     * Load keys from backend the first time they are accessed, instead of holding all of them
+     *
+     * Only the keys that were loaded can be encoded, so the storage has to be written back as a
+     * delta. Lazily loaded dictionaries cannot be cleared.
+     */
+    void set_backend(std::shared_ptr<StorageBackend> backend);
+
+    /**
+     * Record the keys that are read and written from now on
+     *
+     * A key counts as read if the program could tell what it holds, even if it holds nothing.
+     */
+    void track_accesses() { m_accesses.reset(new Accesses()); }
+
+    const std::set<std::string> &reads() const { return m_accesses->reads; }
+    const std::set<std::string> &writes() const { return m_accesses->writes; }
+
+    /**
+     * Record changes from now on, so they can be undone
+     *
+     * Savepoints nest. Releasing a savepoint with commit() or rollback() also releases all
+     * savepoints that were taken after it.
+     */
+    size_t savepoint();
+
+    /**
+     * Keep the changes made since the savepoint
+     *
+     * They can still be undone by rolling back an enclosing savepoint.
+     */
+    void commit(size_t savepoint);
+
+    /**
+     * Undo the changes made since the savepoint, in time proportional to the number of keys
+     * that were changed
+     */
+    void rollback(size_t savepoint);
+
+    /**
+     * The keys that were changed since the savepoint
+     */
+    std::set<std::string> changed_keys(size_t savepoint) const;
+
+private:
+    struct Accesses
+    {
+        std::set<std::string> reads;
+        std::set<std::string> writes;
+    };
+
+    struct Backend
+    {
+        std::shared_ptr<StorageBackend> backend;
+        std::unordered_set<std::string> loaded; // includes keys the backend had no value for
+    };
+
+    struct Change
+    {
+        std::string key;
+        std::optional<StorageValue> previous; // empty if key held nothing
+    };
+
+    /**
+     * Only the first change of a key after a savepoint is recorded, since that is the value
+     * rolling back to it restores
+     */
+    struct Journal
+    {
+        std::vector<Change> changes;
+        std::vector<size_t> savepoints; // number of changes when each savepoint was taken
+        std::vector<std::unordered_set<std::string>> keys; // keys recorded after each savepoint
+    };
+
+    void load(const std::string &key)
+    {
+        if(m_backend)
+            load_from_backend(key);
+    }
+
+    void load_from_backend(const std::string &key);
+
+    void record_read(const std::string &key)
+    {
+        if(m_accesses)
+            m_accesses->reads.insert(key);
+    }
+
+    void record_write(const std::string &key)
+    {
+        if(m_accesses)
+            m_accesses->writes.insert(key);
+        if(m_journal)
+            journal(key);
+    }
+
+    void journal(const std::string &key);
 
-    std::map<std::string, std::string> m_elements_string;
-    std::map<std::string, int64_t> m_elements_int;
-    std::map<std::string, double> m_elements_double;
-    std::map<std::string, bool> m_elements_bool;
+    // only set while needed, so other dictionaries take no more heap memory
+    std::unique_ptr<Backend> m_backend;
+    std::unique_ptr<Accesses> m_accesses;
+    std::unique_ptr<Journal> m_journal;
 };
 
 } // namespace cow
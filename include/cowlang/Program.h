@@ -0,0 +1,195 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "InterpreterTypes.h"
+#include "NodeType.h"
+
+class bitstream_view;
+
+namespace cow
+{
+
+class Program;
+
+constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+/**
+ * Reason why a node could not be decoded from the bytecode
+ *
+ * Decoding never throws: broken bytecode is turned into faulty nodes that raise the error the
+ * moment the interpreter reaches them, just like reading the raw stream used to.
+ */
+enum class Fault : uint8_t
+{
+    None,
+    Truncated,   // not even the node type could be read
+    UnknownType, // the node type is not known to the interpreter
+    Malformed,   // the payload of the node is broken; raised when the node is reached
+    Late,        // like Malformed, but raised after the first child has been evaluated
+    Stub,        // broken function stub; raised at the stage stored in `integer`
+    Opaque       // raw bytes that only ever get skipped (comprehension filters)
+};
+
+/**
+ * A single node of the syntax tree after it has been decoded
+ *
+ * Nodes are stored in pre-order: the children of a node directly follow it and `end` is the
+ * index of its next sibling. Only the fields used by the node's type are set.
+ */
+struct Instruction
+{
+    static constexpr uint32_t NO_ERROR = std::numeric_limits<uint32_t>::max();
+
+    NodeType type = NodeType::Pass;
+    Fault fault = Fault::None;
+
+    uint32_t op = 0;   // operator of UnaryOp, BinaryOp, BoolOp and AugmentedAssign
+    uint32_t size = 0; // number of statements, items, arguments, targets or comparisons
+
+    uint32_t name = 0;     // interned string of Name, String and Alias nodes
+    uint32_t as_name = 0;  // Alias: interned as-name
+    uint32_t operand = 0;  // Compare: first operator; FunctionDef: root of the body
+    int32_t integer = 0;   // Integer: the constant
+
+    // Name and String: frame of the code the node is part of and the slot of the name in it
+    // FunctionDef: frame of the body
+    uint32_t frame = 0;
+    uint32_t slot = NO_SLOT;
+
+    uint32_t end = 0;
+
+    // steps charged when the subtree gets skipped, and the error raised if it can't be skipped
+    uint32_t skip_cost = 0;
+    uint32_t skip_error = NO_ERROR;
+
+    uint32_t error = NO_ERROR; // message raised by a faulty node
+};
+
+/**
+ * A variable name, resolved to its slot in a frame of a program
+ *
+ * Symbols that were created from a plain string (by the host or by modules) have no program and
+ * are resolved when they are used.
+ */
+struct Symbol
+{
+    const std::string *name = nullptr;
+    const Program *program = nullptr;
+    uint32_t id = NO_SLOT;
+    uint32_t frame = NO_SLOT;
+    uint32_t slot = NO_SLOT;
+    BuiltinName builtin = BuiltinName::NotBuiltin; // only resolved for symbols of a program
+
+    Symbol() = default;
+    explicit Symbol(const std::string &str) : name(&str) {}
+
+    const std::string &str() const { return *name; }
+};
+
+/**
+ * The code of a function definition
+ *
+ * Shared by all function values created from the definition, so defining or copying a function
+ * copies neither code nor names.
+ */
+struct FunctionCode
+{
+    uint32_t entry = 0; // root of the body
+    uint32_t frame = 0; // frame of the body
+    std::vector<Symbol> params;
+};
+
+/**
+ * A compiled program, decoded once into a flat array of instructions
+ *
+ * Strings are interned, so the interpreter never re-parses the bytecode while executing it.
+ * Programs are immutable and shared by the interpreter and all functions defined by it.
+ */
+class Program
+{
+public:
+    Program(bitstream_view data);
+
+    const Instruction &operator[](uint32_t index) const { return m_code[index]; }
+
+    const std::string &string(uint32_t id) const { return m_strings[id]; }
+
+    CompareOpType compare_op(uint32_t index) const { return m_compare_ops[index]; }
+
+    uint32_t size() const { return m_code.size(); }
+
+    /**
+     * Estimate of the heap memory held by the decoded program, in bytes
+     */
+    size_t memory_usage() const;
+
+    /**
+     * Look up an interned string
+     *
+     * @return its id or NO_SLOT if the program doesn't contain it
+     */
+    uint32_t find(const std::string &str) const;
+
+    /**
+     * Variables are stored in frames: the top level frame (0) has a slot for every string of the
+     * program, every function has a frame with a slot for each name used by its code.
+     */
+    uint32_t frame_size(uint32_t frame) const;
+
+    /**
+     * @return the slot of the string id in frame, or NO_SLOT if the frame has none for it
+     */
+    uint32_t slot(uint32_t frame, uint32_t id) const;
+
+    Symbol symbol(const Instruction &node) const;
+
+    /**
+     * The function whose body has the given frame
+     */
+    const FunctionCode &function(uint32_t frame) const { return m_functions[frame]; }
+
+    /**
+     * Resolve a name in frame. The string has to outlive the symbol.
+     */
+    Symbol symbol(uint32_t frame, const std::string &str) const;
+
+    /**
+     * Read the Name or String node at pc and advance pc past it
+     */
+    const std::string &read_name(uint32_t &pc) const;
+    Symbol read_symbol(uint32_t &pc) const;
+
+    /**
+     * Read a name or a pair of names (as used by loop and assignment targets)
+     *
+     * @return the number of names read
+     */
+    uint32_t read_symbols(uint32_t &pc, Symbol symbols[2]) const;
+
+private:
+    friend class ProgramDecoder;
+
+    const Instruction &name_node(uint32_t pc) const;
+
+    std::vector<Instruction> m_code;
+    std::vector<std::string> m_strings;
+    std::vector<BuiltinName> m_builtins; // the builtin each string refers to
+    std::unordered_map<std::string, uint32_t> m_ids;
+    std::vector<CompareOpType> m_compare_ops;
+
+    // sorted string ids of the names of each function frame, the slot is the index
+    std::vector<std::vector<uint32_t>> m_frames;
+
+    // indexed by frame, like m_frames
+    std::vector<FunctionCode> m_functions;
+};
+
+typedef std::shared_ptr<const Program> ProgramPtr;
+
+} // namespace cow
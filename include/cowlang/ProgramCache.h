@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+#include "Program.h"
+#include "Snapshot.h"
+
+namespace cow
+{
+
+/**
+ * Process-wide cache of decoded contracts
+ *
+ * Contracts are identified by the SHA-256 of their compressed bytecode. An entry holds the
+ * decompressed and decoded program, including the table of its functions, so calling the same
+ * contract again neither decompresses nor decodes it. Once the contract was initialized, the
+ * entry also holds a snapshot of its globals. Least recently used entries are evicted
+ * once the programs use more memory than the budget allows. Thread-safe.
+ */
+class ProgramCache
+{
+public:
+    static constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    static ProgramCache &instance();
+
+    ProgramCache(size_t budget = DEFAULT_BUDGET) : m_budget(budget) {}
+
+    typedef std::array<uint8_t, 32> Key;
+
+    /**
+     * Identify a contract by its compressed bytecode
+     */
+    static Key hash(const std::string &compressed);
+
+    /**
+     * Get the program of a compressed contract, decoding it if it is not cached yet
+     *
+     * @throws std::runtime_error if the contract cannot be decompressed
+     */
+    ProgramPtr get(const std::string &compressed);
+
+    /**
+     * Like get(), but also look up the snapshot that was stored for the contract
+     *
+     * @param snapshot
+     *      Set to the snapshot or to nullptr if there is none
+     */
+    ProgramPtr get(const Key &key, const std::string &compressed, SnapshotPtr &snapshot);
+
+    /**
+     * Keep the state after initializing a cached contract, so it can be restored by later calls
+     */
+    void set_snapshot(const Key &key, SnapshotPtr snapshot);
+
+    /**
+     * Evict entries until the cached programs fit into budget bytes
+     */
+    void set_budget(size_t budget);
+
+    void clear();
+
+    size_t size() const;
+    size_t memory_usage() const;
+
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            // the key is a cryptographic hash already
+            size_t hash;
+            memcpy(&hash, key.data(), sizeof(hash));
+            return hash;
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        ProgramPtr program;
+        SnapshotPtr snapshot;
+        size_t cost;
+    };
+
+    void evict(size_t budget);
+
+    mutable std::mutex m_mutex;
+
+    std::list<Entry> m_entries; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+
+    size_t m_budget;
+    size_t m_usage = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+};
+
+} // namespace cow
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <array>
 #include <set>
 #include <unordered_map>
 
+#include "ExecutionContext.h"
 #include "List.h"
+#include "Program.h"
 #include "Tuple.h"
 #include "Value.h"
 
@@ -21,12 +24,47 @@ public:
     static constexpr const char *BUILTIN_STR_LENGTH = "len";
     static constexpr const char *BUILTIN_STR_MAX = "max";
     static constexpr const char *BUILTIN_STR_MIN = "min";
+    static constexpr const char *BUILTIN_STR_SUM = "sum";
+    static constexpr const char *BUILTIN_STR_SORTED = "sorted";
+    static constexpr const char *BUILTIN_STR_ANY = "any";
+    static constexpr const char *BUILTIN_STR_ALL = "all";
+    static constexpr const char *BUILTIN_STR_ENUMERATE = "enumerate";
+    static constexpr const char *BUILTIN_STR_ZIP = "zip";
+    static constexpr const char *BUILTIN_STR_ABS = "abs";
     static constexpr const char *BUILTIN_STR_CLEAR = "clear";
     static constexpr const char *BUILTIN_STR_CLEARLIMITS = "clearlimits";
+    static constexpr const char *BUILTIN_STR_TRUE = "True";
+    static constexpr const char *BUILTIN_STR_FALSE = "False";
 
-    Scope(MemoryManager &mem) : Object(mem), m_parent(nullptr), depth(0) {}
-    Scope(MemoryManager &mem, Scope &parent)
-    : Object(mem), m_parent(&parent), depth(parent.depth + 1)
+    /**
+     * Find out which builtin (if any) a name refers to
+     */
+    static BuiltinName builtin_name(const std::string &name);
+
+    Scope(MemoryManager &mem) : Object(mem), m_parent(nullptr), m_root(this), depth(0) {}
+
+    /**
+     * Top level scope that keeps the variables of program's frame in slots
+     */
+    Scope(MemoryManager &mem, ProgramPtr program, uint32_t frame)
+    : Object(mem), m_parent(nullptr), m_root(this), depth(0), m_program(std::move(program)),
+      m_frame(frame)
+    {
+    }
+
+    /**
+     * Nested scope, with the same frame as its parent
+     */
+    Scope(MemoryManager &mem, Scope &parent) : Scope(mem, parent, parent.m_program, parent.m_frame)
+    {
+    }
+
+    /**
+     * Nested scope for the code of another frame (the body of a function)
+     */
+    Scope(MemoryManager &mem, Scope &parent, ProgramPtr program, uint32_t frame)
+    : Object(mem), m_parent(&parent), m_root(parent.m_root), depth(parent.depth + 1),
+      m_program(std::move(program)), m_frame(frame)
     {
         if(depth >= 128)
         {
@@ -34,23 +72,81 @@ public:
         }
     }
 
-    ValuePtr get_value(const std::string &id);
-    void set_value(const std::string &name, ValuePtr value);
-    bool has_value(const std::string &name) const;
-    void set_global_tag(const std::string &name);
+    ValuePtr get_value(const std::string &id) { return get_value(Symbol(id)); }
+    void set_value(const std::string &name, ValuePtr value)
+    {
+        set_value(Symbol(name), std::move(value));
+    }
+    bool has_value(const std::string &name) const { return has_value(Symbol(name)); }
+    void set_global_tag(const std::string &name) { set_global_tag(Symbol(name)); }
+
+    ValuePtr get_value(const Symbol &symbol);
+    void set_value(const Symbol &symbol, ValuePtr value);
+    bool has_value(const Symbol &symbol) const;
+    void set_global_tag(const Symbol &symbol);
+
+    /**
+     * Replace the value of an existing variable in the scope that holds it
+     */
+    void update_value(const Symbol &symbol, ValuePtr value);
+
+    /**
+     * The context of the execution the scope belongs to
+     */
+    ExecutionContext &context() const
+    {
+        return m_root->m_context ? *m_root->m_context : ExecutionContext::global();
+    }
+
+    void set_context(ExecutionContext &context) { m_root->m_context = &context; }
+
     void terminate();
     bool is_terminated() const;
     int get_depth() { return depth; }
-    void require_global() { m_require_global = true; };
 
 private:
+    struct Slot
+    {
+        ValuePtr value;
+        bool assigned = false;
+        bool global = false;
+    };
+
+    /**
+     * Find the slot of this scope that stores symbol
+     *
+     * @return NO_SLOT if the frame has no slot for it and it's kept by name instead
+     */
+    uint32_t locate(const Symbol &symbol) const;
+
+    // the value stored for symbol in this scope, nullptr if there is none
+    const ValuePtr *find(const Symbol &symbol) const;
+    ValuePtr *find(const Symbol &symbol)
+    {
+        return const_cast<ValuePtr *>(static_cast<const Scope *>(this)->find(symbol));
+    }
+
+    Slot &slot(uint32_t index);
+
+    ValuePtr get_builtin(BuiltinName name);
+
     Scope *m_parent;
+    Scope *m_root;
+    ExecutionContext *m_context = nullptr; // only set for the root
     bool m_terminated = false;
-    bool m_require_global = false;
     int depth;
 
+    ProgramPtr m_program;
+    uint32_t m_frame = 0;
+    std::vector<Slot> m_slots; // allocated on first assignment
+
+    // variables that have no slot in the frame, e.g. those set by the host or by modules
     std::unordered_map<std::string, ValuePtr> m_values;
     std::set<std::string> m_global_tags;
+
+    // Builtins are immutable, so each is created once (by the root scope) and then shared
+    static constexpr size_t NUM_BUILTINS = static_cast<size_t>(BuiltinName::Abs) + 1;
+    std::unique_ptr<std::array<ValuePtr, NUM_BUILTINS>> m_builtins;
 };
 
 } // namespace cow
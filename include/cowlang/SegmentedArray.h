@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stddef.h>
+#include <utility>
+
+#include "Object.h"
+
+namespace cow
+{
+
+/**
+ * Raw storage for an array in the memory of a memory manager
+ *
+ * Memory managers can only allocate blocks smaller than a page. Small arrays are a single block
+ * of exactly their capacity. Once an array outgrows a segment, it is split into segments of
+ * SEGMENT_LENGTH elements, so it can grow as long as the memory manager has pages left.
+ *
+ * The array does not know which slots hold elements: the owner constructs and destroys them.
+ */
+template <typename T> class SegmentedArray
+{
+public:
+    static constexpr size_t SEGMENT_BYTES = 64 * 1024;
+
+    // largest power of two that fits into a segment, so indexing is a shift and a mask
+    static constexpr size_t SEGMENT_LENGTH = [] {
+        size_t length = 1;
+        while(length * 2 * sizeof(T) <= SEGMENT_BYTES)
+            length *= 2;
+        return length;
+    }();
+
+    SegmentedArray(MemoryManager &mem) : m_mem(mem) {}
+
+    SegmentedArray(const SegmentedArray &other) = delete;
+
+    ~SegmentedArray() { release(); }
+
+    size_t capacity() const { return m_capacity; }
+
+    T &operator[](size_t index)
+    {
+        return m_segments[index / SEGMENT_LENGTH][index % SEGMENT_LENGTH];
+    }
+
+    const T &operator[](size_t index) const
+    {
+        return m_segments[index / SEGMENT_LENGTH][index % SEGMENT_LENGTH];
+    }
+
+    /**
+     * Call f(elements, count) for each contiguous run of the first used elements, in order
+     */
+    template <typename F> void for_each_run(size_t used, F f) const
+    {
+        for(size_t i = 0; i < m_num_segments && used > 0; ++i)
+        {
+            auto count = std::min(used, SEGMENT_LENGTH);
+            f(static_cast<const T *>(m_segments[i]), count);
+            used -= count;
+        }
+    }
+
+    /**
+     * Make room for at least capacity elements, moving the first used ones if needed
+     *
+     * Allocates before anything is moved, so the array is unchanged if the memory manager
+     * runs out of memory.
+     */
+    void reserve(size_t capacity, size_t used)
+    {
+        if(capacity <= m_capacity)
+            return;
+
+        if(m_capacity < SEGMENT_LENGTH)
+        {
+            // a single segment, grow it by reallocating
+            auto length = std::min(std::max(capacity, m_capacity * 2), SEGMENT_LENGTH);
+            auto segment = static_cast<T *>(m_mem.malloc(length * sizeof(T)));
+
+            T **segments = m_segments;
+            if(segments == nullptr)
+            {
+                try
+                {
+                    segments = static_cast<T **>(m_mem.malloc(sizeof(T *)));
+                }
+                catch(...)
+                {
+                    m_mem.free(segment);
+                    throw;
+                }
+                m_num_segments = 1;
+            }
+
+            for(size_t i = 0; i < used; ++i)
+            {
+                new(&segment[i]) T(std::move(segments[0][i]));
+                segments[0][i].~T();
+            }
+
+            if(m_segments != nullptr)
+                m_mem.free(m_segments[0]);
+
+            segments[0] = segment;
+            m_segments = segments;
+            m_capacity = length;
+        }
+
+        while(m_capacity < capacity)
+        {
+            // add full segments, there are few of them so the table is simply reallocated
+            auto segments = static_cast<T **>(m_mem.malloc((m_num_segments + 1) * sizeof(T *)));
+            T *segment;
+
+            try
+            {
+                segment = static_cast<T *>(m_mem.malloc(SEGMENT_LENGTH * sizeof(T)));
+            }
+            catch(...)
+            {
+                m_mem.free(segments);
+                throw;
+            }
+
+            memcpy(segments, m_segments, m_num_segments * sizeof(T *));
+            segments[m_num_segments] = segment;
+            m_mem.free(m_segments);
+
+            m_segments = segments;
+            m_num_segments += 1;
+            m_capacity += SEGMENT_LENGTH;
+        }
+    }
+
+    /**
+     * Free all memory, the owner has to destroy the elements first
+     */
+    void release()
+    {
+        for(size_t i = 0; i < m_num_segments; ++i)
+            m_mem.free(m_segments[i]);
+
+        if(m_segments != nullptr)
+            m_mem.free(m_segments);
+
+        m_segments = nullptr;
+        m_num_segments = 0;
+        m_capacity = 0;
+    }
+
+    /**
+     * Exchange the contents with an array of the same memory manager
+     */
+    void swap(SegmentedArray &other)
+    {
+        std::swap(m_segments, other.m_segments);
+        std::swap(m_num_segments, other.m_num_segments);
+        std::swap(m_capacity, other.m_capacity);
+    }
+
+private:
+    MemoryManager &m_mem;
+
+    T **m_segments = nullptr;
+    size_t m_num_segments = 0;
+    size_t m_capacity = 0;
+};
+
+} // namespace cow
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Program.h"
+#include "Value.h"
+
+namespace cow
+{
+
+/**
+ * The global state of an interpreter right after it executed the top level code of a program
+ *
+ * Top level code can only define functions and import modules. A snapshot keeps the functions
+ * and the imports, so interpreters restored from it start out with the same globals without
+ * executing any of the definitions again.
+ *
+ * Snapshots are immutable and can be shared by interpreters of different threads. The functions
+ * are immortal values of the snapshot: restored interpreters only reference them, and assigning
+ * to a global only ever changes the scope of the interpreter that does it.
+ *
+ * @note The functions must not be used after the snapshot was destroyed. Interpreters restored
+ *       from a snapshot keep it alive for that reason.
+ */
+class Snapshot
+{
+public:
+    /**
+     * Something the top level code bound to a global name
+     */
+    struct Definition
+    {
+        enum class Kind
+        {
+            Function,
+            Import,    // import <module> as <name>
+            ImportFrom // from <module> import <member> as <name>
+        };
+
+        Kind kind;
+        Symbol name;                         // Function: name of the function
+        const FunctionCode *code = nullptr;  // Function
+        ValuePtr function;                   // Function, only set for definitions of a snapshot
+        std::string module, member, as_name; // Import and ImportFrom
+    };
+
+    Snapshot(ProgramPtr program, std::vector<Definition> definitions, uint32_t num_execution_steps);
+    ~Snapshot();
+
+    Snapshot(const Snapshot &other) = delete;
+
+    const ProgramPtr &program() const { return m_program; }
+
+    const std::vector<Definition> &definitions() const { return m_definitions; }
+
+    /**
+     * Number of steps the top level code took, restoring the snapshot charges as many
+     */
+    uint32_t num_execution_steps() const { return m_num_execution_steps; }
+
+    /**
+     * Estimate of the heap memory held by the snapshot, in bytes
+     */
+    size_t memory_usage() const;
+
+private:
+    DummyMemoryManager m_mem; // only holds the functions
+    ProgramPtr m_program;
+    std::vector<Definition> m_definitions;
+    uint32_t m_num_execution_steps;
+};
+
+typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+} // namespace cow
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+#include "PersistableDictionary.h"
+
+namespace cow
+{
+
+/**
+ * Where a persistent dictionary loads keys from the first time they are accessed
+ *
+ * Contracts with a large storage usually access only a few keys per call. Loading these on
+ * demand instead of decoding the complete storage makes starting a call independent of the
+ * size of the storage.
+ */
+class StorageBackend
+{
+public:
+    virtual ~StorageBackend() = default;
+
+    /**
+     * Make key of storage hold the value the backend has for it, or nothing if it has none
+     */
+    virtual void load(const std::string &key, StorageState &storage) = 0;
+};
+
+/**
+ * Backend that asks the host for every key
+ */
+class CallbackStorageBackend : public StorageBackend
+{
+public:
+    /**
+     * Returns the key encoded like StorageState::encode({key}) does, or an empty string if the
+     * host has no value for it
+     */
+    typedef std::function<std::string(const std::string &key)> Callback;
+
+    CallbackStorageBackend(Callback callback) : m_callback(std::move(callback)) {}
+
+    void load(const std::string &key, StorageState &storage) override;
+
+private:
+    Callback m_callback;
+};
+
+/**
+ * Backend that copies keys from a storage in memory
+ *
+ * The storage is only read, so any number of dictionaries can load from it at the same time,
+ * as long as nothing changes it meanwhile.
+ */
+class StateStorageBackend : public StorageBackend
+{
+public:
+    StateStorageBackend(const StorageState &state) : m_state(state) {}
+
+    void load(const std::string &key, StorageState &storage) override;
+
+private:
+    const StorageState &m_state;
+};
+
+/**
+ * Backend that looks keys up in a file written by write()
+ *
+ * The file holds the encoded storage, followed by the offsets of its entries and their number.
+ * The entries are sorted, so keys are found by a binary search without reading the whole file.
+ * Thread-safe.
+ */
+class FileStorageBackend : public StorageBackend
+{
+public:
+    FileStorageBackend(const std::string &path);
+
+    static void write(const std::string &path, const StorageState &storage);
+
+    void load(const std::string &key, StorageState &storage) override;
+
+private:
+    std::string read(uint64_t offset, uint32_t length);
+    uint32_t read_offset(uint32_t index);
+    std::string read_key(uint32_t offset);
+
+    std::mutex m_mutex; // guards the read position of the file
+    std::ifstream m_file;
+
+    uint32_t m_size;         // number of entries
+    uint32_t m_index_offset; // where the offsets of the entries start
+};
+
+} // namespace cow
@@ -31,6 +31,6 @@ private:
     std::vector<ValuePtr> m_content;
 };
 
-typedef std::shared_ptr<Tuple> TuplePtr;
+typedef ObjectPtr<Tuple> TuplePtr;
 
 } // namespace cow
@@ -60,13 +60,9 @@ inline std::ostream &operator<<(std::ostream &stream, ValueType type)
 }
 #endif
 
-class Value;
-typedef std::shared_ptr<Value> ValuePtr;
+template <typename T> ObjectPtr<T> wrap_value(T *val) { return ObjectPtr<T>{ val }; }
 
-template <typename T> std::shared_ptr<T> wrap_value(T *val) { return std::shared_ptr<T>{ val }; }
-
-template <typename T, class... Args>
-std::shared_ptr<T> make_value(MemoryManager &mem, Args &&... args)
+template <typename T, class... Args> ObjectPtr<T> make_value(MemoryManager &mem, Args &&... args)
 {
     auto val = new(mem) T(mem, std::forward<Args>(args)...);
     return wrap_value(val);
@@ -128,12 +124,11 @@ public:
 
     const value_type &get() const { return m_value; }
 
-    void set(const value_type &v) { m_value = v; }
-
     std::string str() const override { return std::to_string(m_value); }
 
 protected:
-    value_type m_value;
+    // immediates are shared by all executions, so values never change
+    const value_type m_value;
 };
 
 class Alias : public Value
@@ -175,6 +170,7 @@ class StringVal : public Value
 {
 public:
     StringVal(MemoryManager &mem, const std::string &val) : Value(mem), m_value(val) {}
+    StringVal(MemoryManager &mem, std::string &&val) : Value(mem), m_value(std::move(val)) {}
 
     ValuePtr duplicate(MemoryManager &mem) override
     {
@@ -189,6 +185,11 @@ public:
 
     const std::string &get() const { return m_value; }
 
+    /**
+     * The string methods, see StringMethod
+     */
+    ValuePtr get_member(const std::string &name) override;
+
 private:
     std::string m_value;
 };
@@ -217,11 +218,6 @@ public:
     bool bool_test() const override { return m_value != 0; }
 };
 
-typedef std::shared_ptr<IntVal> IntValPtr;
-typedef std::shared_ptr<StringVal> StringValPtr;
-typedef std::shared_ptr<FloatVal> FloatValPtr;
-typedef std::shared_ptr<BoolVal> BoolValPtr;
-
 class value_exception : public std::exception
 {
 public:
@@ -233,13 +229,13 @@ private:
     const std::string m_what;
 };
 
-template <typename T> std::shared_ptr<T> value_cast(ValuePtr val)
+template <typename T> ObjectPtr<T> value_cast(const ValuePtr &val)
 {
-    auto res = std::dynamic_pointer_cast<T>(val);
+    auto res = dynamic_cast<T *>(val.get());
     if(res == nullptr)
         throw value_exception("Invalid value cast");
 
-    return res;
+    return ObjectPtr<T>(res);
 }
 
 
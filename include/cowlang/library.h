@@ -1,6 +1,10 @@
 #ifndef LIB_CPTH
 #define LIB_CPTH
+#include <cowlang/StorageBackend.h>
+#include <map>
+#include <memory>
 #include <modules/blockchain_module.h>
+#include <sstream>
 #include <string.h>
 
 int execute_program(std::string &raw,
@@ -12,8 +16,52 @@ int execute_program(std::string &raw,
                     std::string &old_storage,
                     std::stringstream &s,
                     std::string &data);
+
+/**
+ * Execute a contract in the environment of context
+ *
+ * Executions with different contexts can run concurrently. Afterwards, context holds what the
+ * contract sent and the remaining contract balance.
+ *
+ * The new storage is written to s in the binary storage format of StorageState, also if the
+ * execution failed and the storage is unchanged. The old storage can also be a boost text
+ * archive, as written by earlier versions.
+ */
+int execute_program(std::string &raw,
+                    cow::ExecutionContext &context,
+                    uint64_t gas,
+                    uint32_t gasprice,
+                    uint64_t &gasused,
+                    std::string &old_storage,
+                    std::stringstream &s,
+                    std::string &data);
+
+/**
+ * Execute a contract whose storage is loaded from backend, key by key as the contract accesses it
+ *
+ * Instead of the complete new storage, s receives the delta that get_storage_delta() returns.
+ */
+int execute_program(std::string &raw,
+                    cow::ExecutionContext &context,
+                    uint64_t gas,
+                    uint32_t gasprice,
+                    uint64_t &gasused,
+                    std::shared_ptr<cow::StorageBackend> backend,
+                    std::stringstream &s,
+                    std::string &data);
+
 void init_cryptopython();
+
+// output, errors and sends of the last execution of the calling thread
 std::string get_errorbuf();
 std::string get_outbuf();
+std::map<std::string, uint64_t> get_send_map();
+
+/**
+ * The keys the last execution of the calling thread changed, in the binary storage format
+ *
+ * Hosts that keep the storage decoded can apply the delta instead of the complete new storage.
+ */
+std::string get_storage_delta();
 
 #endif
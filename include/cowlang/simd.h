@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace cow
+{
+
+/**
+ * Kernels over the unboxed elements of integer lists
+ *
+ * Each picks the widest instruction set the CPU supports (AVX2, SSE4.2 or none) the first time
+ * it is called. All variants return exactly the same results, so executions stay deterministic
+ * across machines.
+ */
+namespace simd
+{
+
+bool contains(const int64_t *values, size_t size, int64_t value);
+
+/**
+ * Smallest/largest value, size has to be at least one
+ */
+int64_t min(const int64_t *values, size_t size);
+int64_t max(const int64_t *values, size_t size);
+
+/**
+ * Sum of the values, wrapping around on overflow
+ */
+int64_t sum(const int64_t *values, size_t size);
+
+namespace detail
+{
+
+enum class Level
+{
+    None,
+    SSE42,
+    AVX2
+};
+
+struct Kernels
+{
+    bool (*contains)(const int64_t *values, size_t size, int64_t value);
+    int64_t (*min)(const int64_t *values, size_t size);
+    int64_t (*max)(const int64_t *values, size_t size);
+    int64_t (*sum)(const int64_t *values, size_t size);
+};
+
+/**
+ * The kernels of the given instruction set, nullptr if the CPU does not support it
+ *
+ * Lets tests run every variant, not just the one picked for this machine.
+ */
+const Kernels *kernels(Level level);
+
+} // namespace detail
+} // namespace simd
+} // namespace cow
@@ -2,6 +2,7 @@
 #define BLOCKCHAIN_MODULE_H
 #include <base58.h>
 #include <btc.h>
+#include <cowlang/ExecutionContext.h>
 #include <cowlang/Interpreter.h>
 #include <cowlang/Module.h>
 #include <cowlang/PersistableDictionary.h>
@@ -37,27 +38,6 @@ typedef struct
     uint64_t contract_balance;
 } blockchain_arguments;
 
-namespace cow
-{
-enum class net_type
-{
-    MAIN,
-    TEST,
-    REGTEST
-};
-extern net_type net;
-extern std::map<std::string, uint64_t> send_map;
-extern std::string txid;
-extern std::string current_block;
-extern std::string previous_block;
-extern uint32_t current_time;
-extern uint32_t current_height;
-extern uint32_t previous_time;
-extern std::string sender;
-extern std::string contract_address;
-extern uint64_t value;
-extern uint64_t contract_balance;
-} // namespace cow
 #define s(i) _s[i]
 
 #define SWAP_BYTE(A, B)                 \
@@ -73,8 +53,7 @@ namespace cow
 class BlockchainModule : public Module
 {
 public:
-    BlockchainModule(MemoryManager &mem);
-    using Module::Module;
+    BlockchainModule(MemoryManager &mem, ExecutionContext &context);
     ValuePtr get_member(const std::string &name);
 
 private:
@@ -95,6 +74,7 @@ private:
     ValuePtr suicide(Scope &scope);
     ValuePtr get_contract_balance(Scope &scope);
     std::map<std::string, ValuePtr> function_map;
+    ExecutionContext &m_context;
     void seed();
 
     // RC$
@@ -174,6 +154,6 @@ private:
 void register_blockchain_module(cow::Interpreter &i);
 }; // namespace cow
 
-bool addr_check(const char *address);
+bool addr_check(const char *address, cow::net_type net);
 
 #endif /* end of include guard: BLOCKCHAIN_MODULE_H */
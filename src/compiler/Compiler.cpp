@@ -7,6 +7,8 @@
 #include "pypa/parser/parser.hh"
 #include "pypa/reader.hh"
 
+#include <unordered_map>
+
 #define SAFE_PARSE_NEXT(ptr)                          \
     if(ptr == nullptr)                                \
     {                                                 \
@@ -77,9 +79,45 @@ public:
 
     void run() { SAFE_PARSE_NEXT((m_ast->body)); }
 
-    bitstream get_result() { return std::move(m_result); }
+    bitstream get_result()
+    {
+        bitstream result;
+        result << BYTECODE_MAGIC << BYTECODE_VERSION;
+
+        result << static_cast<uint32_t>(m_pool.size());
+        for(auto &str : m_pool)
+        {
+            result << str;
+        }
+
+        auto code = m_result.store();
+        result.bytecode.write(code.data(), code.size());
+        return result;
+    }
 
 private:
+    /**
+     * Write a reference to str, adding it to the pool if it's not there yet
+     */
+    void write_string(const std::string &str)
+    {
+        auto it = m_pool_index.find(str);
+        uint32_t index = 0;
+
+        if(it == m_pool_index.end())
+        {
+            index = m_pool.size();
+            m_pool.push_back(str);
+            m_pool_index.emplace(str, index);
+        }
+        else
+        {
+            index = it->second;
+        }
+
+        m_result << index;
+    }
+
     void parse_next(const pypa::AstExpr &expr)
     {
         parse_next(reinterpret_cast<const pypa::Ast &>(expr));
@@ -146,10 +184,14 @@ private:
             {
                 const std::string as_name =
                 reinterpret_cast<const pypa::AstName &>(*alias.as_name).id.c_str();
-                m_result << name << as_name;
+                write_string(name);
+                write_string(as_name);
             }
             else
-                m_result << name << std::string("");
+            {
+                write_string(name);
+                write_string("");
+            }
             break;
         }
         case pypa::AstType::Name:
@@ -157,8 +199,7 @@ private:
             auto &exp = reinterpret_cast<const pypa::AstName &>(stmt);
             m_result << NodeType::Name;
 
-            std::string str = exp.id.c_str();
-            m_result << str;
+            write_string(exp.id.c_str());
             break;
         }
         case pypa::AstType::Assign:
@@ -181,7 +222,7 @@ private:
         {
             auto &str = reinterpret_cast<const pypa::AstStr &>(stmt);
             m_result << NodeType::String;
-            m_result << std::string(str.value.c_str());
+            write_string(str.value.c_str());
             break;
         }
         case pypa::AstType::Return:
@@ -455,6 +496,10 @@ private:
     const pypa::AstModulePtr m_ast;
 
     bitstream m_result; // main execution module
+
+    // names and string constants, referred to by index from the code
+    std::vector<std::string> m_pool;
+    std::unordered_map<std::string, uint32_t> m_pool_index;
 };
 
 bitstream compile_file(const std::string &filename, std::function<void(pypa::Error)> &e)
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <atomic>
+#include <cowlang/BlockExecutor.h>
+#include <cowlang/Interpreter.h>
+#include <cowlang/StorageBackend.h>
+#include <modules/blockchain_module.h>
+#include <thread>
+
+namespace cow
+{
+
+BlockExecutor::BlockExecutor(size_t num_threads) : m_num_threads(num_threads)
+{
+    if(m_num_threads == 0)
+    {
+        m_num_threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+}
+
+std::vector<BlockExecutor::Result> BlockExecutor::execute(std::vector<Transaction> &transactions)
+{
+    std::vector<Execution> executions(transactions.size());
+
+    // the workers only read the storages, so all of them have to exist before
+    for(auto &transaction : transactions)
+    {
+        m_storages[transaction.storage];
+        m_balances.emplace(transaction.storage, transaction.context.contract_balance);
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for(size_t i = next++; i < transactions.size(); i = next++)
+        {
+            auto &transaction = transactions[i];
+            run(transaction, m_storages.at(transaction.storage),
+                m_balances.at(transaction.storage), executions[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < std::min(m_num_threads, transactions.size()); ++i)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+
+    for(auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    // keys each storage got written by the transactions that were committed so far, and the
+    // storages whose balance they changed
+    std::map<std::string, std::set<std::string>> written;
+    std::set<std::string> balance_written;
+    std::vector<Result> results;
+    results.reserve(transactions.size());
+
+    for(size_t i = 0; i < transactions.size(); ++i)
+    {
+        auto &transaction = transactions[i];
+        auto &keys = written[transaction.storage];
+
+        bool conflict =
+        executions[i].reads_balance && balance_written.count(transaction.storage) > 0;
+
+        for(auto &key : executions[i].reads)
+        {
+            if(keys.count(key) > 0)
+            {
+                conflict = true;
+                break;
+            }
+        }
+
+        if(conflict)
+        {
+            // storages are modified in place by now, so start from scratch
+            executions[i] = Execution();
+            run(transaction, m_storages.at(transaction.storage),
+                m_balances.at(transaction.storage), executions[i]);
+            executions[i].result.reexecuted = true;
+        }
+
+        keys.insert(executions[i].writes.begin(), executions[i].writes.end());
+        if(executions[i].writes_balance)
+        {
+            balance_written.insert(transaction.storage);
+        }
+
+        commit(transaction, executions[i]);
+        results.push_back(executions[i].result);
+    }
+
+    return results;
+}
+
+void BlockExecutor::run(const Transaction &transaction,
+                        const StorageState &storage,
+                        uint64_t balance,
+                        Execution &execution)
+{
+    execution.context = transaction.context;
+    execution.context.contract_balance = balance;
+    execution.context.balance_accessed = false;
+    execution.context.output = [&execution](const std::string &str) { execution.output += str; };
+
+    // freed blocks have to be reused, or loops that create temporaries run out of pages. Every
+    // thread keeps its manager and resets it, instead of getting pages from the pool each time
+    static thread_local DefaultMemoryManager mem;
+    mem.reset();
+    mem.set_max_pages(execution.context.max_heap_pages);
+
+    Interpreter pyint(transaction.program, 0, mem);
+    pyint.set_context(execution.context);
+    pyint.set_execution_step_limit(transaction.execution_step_limit);
+    register_blockchain_module(pyint);
+
+    // only the keys the transaction accesses are copied out of the shared storage
+    auto store = pyint.get_storage_pointer();
+    store->set_backend(std::make_shared<StateStorageBackend>(storage));
+    store->track_accesses();
+
+    bool failed = false;
+
+    try
+    {
+        pyint.execute();
+
+        std::string data = transaction.data;
+        pyint.calldata(data);
+    }
+    catch(SuicideException &)
+    {
+        execution.result.error = std::current_exception();
+    }
+    catch(std::exception &)
+    {
+        execution.result.error = std::current_exception();
+        failed = true;
+    }
+
+    execution.result.num_execution_steps = pyint.num_execution_steps();
+    execution.reads = store->reads();
+    execution.reads_balance = execution.context.balance_accessed;
+
+    // like execute_program(), failed transactions don't change the storage
+    if(failed)
+    {
+        return;
+    }
+
+    execution.writes = store->writes();
+    execution.writes_balance = execution.context.contract_balance != balance;
+
+    for(auto &key : execution.writes)
+    {
+        execution.written.copy_key(*store, key);
+    }
+}
+
+void BlockExecutor::commit(Transaction &transaction, Execution &execution)
+{
+    auto &storage = m_storages.at(transaction.storage);
+    for(auto &key : execution.writes)
+    {
+        storage.copy_key(execution.written, key);
+    }
+
+    if(execution.writes_balance)
+    {
+        m_balances.at(transaction.storage) = execution.context.contract_balance;
+    }
+
+    auto output = std::move(transaction.context.output);
+    transaction.context = std::move(execution.context);
+    transaction.context.output = std::move(output);
+
+    if(!execution.output.empty() && transaction.context.output)
+    {
+        transaction.context.output(execution.output);
+    }
+}
+
+} // namespace cow
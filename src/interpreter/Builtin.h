@@ -4,13 +4,14 @@
 #include <cowlang/cow.h>
 
 #include "args.h"
+#include <algorithm>
+#include <cmath>
 #include <cowlang/Value.h>
+#include <cowlang/simd.h>
 #include <cowlang/unpack.h>
 #include <iostream>
 #include <stdio.h>
 
-extern void print_program_output(const std::string &str);
-
 namespace cow
 {
 
@@ -23,8 +24,26 @@ enum class BuiltinType
     Max,
     Print,
     Length,
+    Sum,
+    Sorted,
+    Any,
+    All,
+    Enumerate,
+    Zip,
+    Abs,
 };
 
+/**
+ * Functions that are always available
+ *
+ * Like any call, calling a builtin takes one execution step. Builtins that take iterables
+ * (lists, tuples, dictionaries and iterators) additionally charge one step for every element
+ * they read, and sorted() charges ceil(log2(n)) more steps per element for comparing n elements.
+ * This includes min() and max() of a list, while min() and max() of two integers charge nothing
+ * more, like all builtins that take no iterables. The costs only depend on the size of the
+ * input, not on its contents or on how the builtin is implemented, so they are the same
+ * everywhere.
+ */
 class Builtin : public Callable
 {
 public:
@@ -37,7 +56,10 @@ public:
 
     ValueType type() const override { return ValueType::Builtin; }
 
-    ValuePtr call(const std::vector<ValuePtr> &args, Scope &scope, uint32_t &, uint32_t &) override
+    ValuePtr call(const std::vector<ValuePtr> &args,
+                  Scope &scope,
+                  uint32_t &current_num,
+                  uint32_t &current_max) override
     {
 
         // No nullpointers please
@@ -89,6 +111,13 @@ public:
         }
         else if(m_type == BuiltinType::Min || m_type == BuiltinType::Max)
         {
+            if(args.size() == 1 && args[0]->type() == ValueType::List)
+            {
+                auto list = value_cast<List>(args[0]);
+                charge(current_num, current_max, list->size());
+                return list_extreme(list);
+            }
+
             check_num_args(args, 2);
 
             auto arg1 = args[0];
@@ -134,8 +163,7 @@ public:
             {
                 std::string s = value_cast<StringVal>(arg)->get();
                 char *endptr = nullptr;
-                return wrap_value(new(memory_manager())
-                                  IntVal(memory_manager(), strtol(s.c_str(), &endptr, 10)));
+                return memory_manager().create_integer(strtol(s.c_str(), &endptr, 10));
             }
             else
             {
@@ -147,11 +175,13 @@ public:
             check_num_args(args, 1);
 
             auto arg = args[0];
-            return wrap_value(new(memory_manager()) IntVal(memory_manager(), arg->size()));
+            return memory_manager().create_integer(arg->size());
         }
         else if(m_type == BuiltinType::Print)
         {
             check_num_minargs(args, 1);
+            auto &output = scope.context().output;
+
             for(size_t i = 0; i < args.size(); ++i)
             {
                 std::string prefix = "";
@@ -160,22 +190,185 @@ public:
 
                 auto arg = args[i];
                 if(relaxed_check_is_string(arg))
-                    print_program_output(prefix + value_cast<StringVal>(arg)->get());
+                    output(prefix + value_cast<StringVal>(arg)->get());
                 else
                 {
                     if(!arg)
                     {
-                        print_program_output(
+                        output(
                         prefix + value_cast<StringVal>(memory_manager().create_string("None"))->get());
                     }
                     else
                     {
-                        print_program_output(
+                        output(
                         prefix + value_cast<StringVal>(memory_manager().create_string(arg->str()))->get());
                     }
                 }
             }
-            print_program_output("\n");
+            output("\n");
+        }
+        else if(m_type == BuiltinType::Sum)
+        {
+            check_num_args(args, 1);
+
+            // like +, the result wraps around at 32 bits
+            if(auto list = unboxed_integers(args[0]))
+            {
+                charge(current_num, current_max, list->size());
+
+                uint64_t result = 0;
+                auto integers = list->integers();
+                integers->for_each_run(list->size(), [&](const int64_t *values, size_t count) {
+                    result += static_cast<uint64_t>(simd::sum(values, count));
+                });
+
+                return memory_manager().create_integer(static_cast<int32_t>(result));
+            }
+
+            uint64_t result = 0;
+            for(auto &elem : read_elements(args[0], current_num, current_max))
+            {
+                check_is_integer(elem);
+                result += static_cast<uint64_t>(value_cast<IntVal>(elem)->get());
+            }
+
+            return memory_manager().create_integer(static_cast<int32_t>(result));
+        }
+        else if(m_type == BuiltinType::Sorted)
+        {
+            check_num_args(args, 1);
+
+            if(auto list = unboxed_integers(args[0]))
+            {
+                charge(current_num, current_max, sort_cost(list->size()));
+
+                std::vector<int64_t> sorted;
+                sorted.reserve(list->size());
+                auto integers = list->integers();
+                integers->for_each_run(list->size(), [&](const int64_t *values, size_t count) {
+                    sorted.insert(sorted.end(), values, values + count);
+                });
+
+                std::sort(sorted.begin(), sorted.end());
+                return make_value<List>(memory_manager(), sorted);
+            }
+
+            auto elements = read_elements(args[0], current_num, current_max);
+            charge(current_num, current_max, sort_cost(elements.size()) - elements.size());
+
+            // integers and strings can be sorted, but not mixed
+            for(auto &elem : elements)
+            {
+                if(!elem || !elements[0] || elem->type() != elements[0]->type() ||
+                   (elem->type() != ValueType::Integer && elem->type() != ValueType::String))
+                {
+                    throw std::runtime_error("Can only sort integers or strings");
+                }
+            }
+
+            auto less = [](const ValuePtr &a, const ValuePtr &b) {
+                if(a->type() == ValueType::Integer)
+                    return value_cast<IntVal>(a)->get() < value_cast<IntVal>(b)->get();
+                else
+                    return value_cast<StringVal>(a)->get() < value_cast<StringVal>(b)->get();
+            };
+
+            std::stable_sort(elements.begin(), elements.end(), less);
+
+            auto list = memory_manager().create_list();
+            for(auto &elem : elements)
+            {
+                list->append(elem);
+            }
+
+            return list;
+        }
+        else if(m_type == BuiltinType::Any || m_type == BuiltinType::All)
+        {
+            check_num_args(args, 1);
+
+            // all elements are read, so the cost does not depend on where the first match is
+            bool is_any = (m_type == BuiltinType::Any);
+            bool result = !is_any;
+
+            if(auto list = unboxed_integers(args[0]))
+            {
+                charge(current_num, current_max, list->size());
+
+                auto is_set = [](int64_t i) { return i != 0; };
+                auto integers = list->integers();
+                integers->for_each_run(list->size(), [&](const int64_t *values, size_t count) {
+                    result = is_any ? (result || std::any_of(values, values + count, is_set))
+                                    : (result && std::all_of(values, values + count, is_set));
+                });
+
+                return memory_manager().create_boolean(result);
+            }
+
+            for(auto &elem : read_elements(args[0], current_num, current_max))
+            {
+                bool value = elem && elem->bool_test();
+                result = is_any ? (result || value) : (result && value);
+            }
+
+            return memory_manager().create_boolean(result);
+        }
+        else if(m_type == BuiltinType::Enumerate)
+        {
+            check_num_args(args, 1);
+
+            auto list = memory_manager().create_list();
+            int64_t index = 0;
+
+            for(auto &elem : read_elements(args[0], current_num, current_max))
+            {
+                auto t = memory_manager().create_tuple();
+                t->append(memory_manager().create_integer(index));
+                t->append(elem);
+                list->append(t);
+                index += 1;
+            }
+
+            return list;
+        }
+        else if(m_type == BuiltinType::Zip)
+        {
+            check_num_args(args, 2);
+
+            auto first = read_elements(args[0], current_num, current_max);
+            auto second = read_elements(args[1], current_num, current_max);
+
+            auto list = memory_manager().create_list();
+            for(size_t i = 0; i < std::min(first.size(), second.size()); ++i)
+            {
+                auto t = memory_manager().create_tuple();
+                t->append(first[i]);
+                t->append(second[i]);
+                list->append(t);
+            }
+
+            return list;
+        }
+        else if(m_type == BuiltinType::Abs)
+        {
+            check_num_args(args, 1);
+
+            auto arg = args[0];
+            if(arg->type() == ValueType::Integer)
+            {
+                // negate without overflowing, so abs() of the smallest integer is itself
+                auto i = value_cast<IntVal>(arg)->get();
+                auto negated = static_cast<int64_t>(0 - static_cast<uint64_t>(i));
+                return memory_manager().create_integer(i < 0 ? negated : i);
+            }
+            else if(arg->type() == ValueType::Float)
+            {
+                return memory_manager().create_float(std::fabs(value_cast<FloatVal>(arg)->get()));
+            }
+            else
+            {
+                throw std::runtime_error("Can only take the absolute value of numbers");
+            }
         }
         else
         {
@@ -186,6 +379,72 @@ public:
     }
 
 private:
+    /**
+     * Steps for sorting n elements: reading each, and ceil(log2(n)) comparisons per element
+     */
+    static uint64_t sort_cost(uint64_t n)
+    {
+        uint64_t depth = 0;
+        while((uint64_t(1) << depth) < n)
+        {
+            depth += 1;
+        }
+
+        return n * (depth + 1);
+    }
+
+    /**
+     * arg if it is a list of integers stored unboxed, nullptr otherwise
+     */
+    static ListPtr unboxed_integers(const ValuePtr &arg)
+    {
+        if(arg->type() != ValueType::List)
+            return nullptr;
+
+        auto list = value_cast<List>(arg);
+        return list->integers() ? list : nullptr;
+    }
+
+    /**
+     * min() or max() of a list of integers
+     */
+    ValuePtr list_extreme(const ListPtr &list)
+    {
+        bool is_max = (m_type == BuiltinType::Max);
+
+        if(list->size() == 0)
+        {
+            throw std::runtime_error("min/max of an empty list");
+        }
+
+        if(auto integers = list->integers())
+        {
+            int64_t result = (*integers)[0];
+            integers->for_each_run(list->size(), [&](const int64_t *values, size_t count) {
+                result = is_max ? std::max(result, simd::max(values, count))
+                                : std::min(result, simd::min(values, count));
+            });
+
+            return memory_manager().create_integer(result);
+        }
+
+        // boxed lists can still hold only integers, if they held something else before
+        int64_t result = 0;
+        for(uint32_t i = 0; i < list->size(); ++i)
+        {
+            auto elem = list->get(i);
+            check_is_integer(elem);
+
+            auto value = value_cast<IntVal>(elem)->get();
+            if(i == 0 || (is_max ? value > result : value < result))
+            {
+                result = value;
+            }
+        }
+
+        return memory_manager().create_integer(result);
+    }
+
     const BuiltinType m_type;
 };
 
@@ -1,24 +1,95 @@
 #include <cowlang/Dictionary.h>
 #include <cowlang/Tuple.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
 
 namespace cow
 {
 
+namespace
+{
+
+inline uint64_t rotate_left(uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+inline void sip_round(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3)
+{
+    v0 += v1;
+    v1 = rotate_left(v1, 13);
+    v1 ^= v0;
+    v0 = rotate_left(v0, 32);
+    v2 += v3;
+    v3 = rotate_left(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotate_left(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotate_left(v1, 17);
+    v1 ^= v2;
+    v2 = rotate_left(v2, 32);
+}
+
+/**
+ * SipHash-1-3 of data, the variant Python and Rust use for hash tables
+ */
+uint64_t sip_hash(const std::array<uint64_t, 2> &key, const std::string &data)
+{
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+
+    auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+    auto end = bytes + (data.size() & ~size_t(7));
+
+    for(; bytes != end; bytes += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(word));
+
+        v3 ^= word;
+        sip_round(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+
+    // the last word holds the remaining bytes and the length
+    uint64_t last = static_cast<uint64_t>(data.size()) << 56;
+    for(size_t i = 0; i < (data.size() & 7); ++i)
+    {
+        last |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    }
+
+    v3 ^= last;
+    sip_round(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace
+
 DictItemIterator::DictItemIterator(MemoryManager &mem, Dictionary &dict)
-: Generator(mem), m_dict(dict), m_it(dict.elements().begin())
+: Generator(mem), m_dict(dict), m_pos(0)
 {
 }
 
 ValuePtr DictItemIterator::next()
 {
-    if(m_it == m_dict.elements().end())
+    if(m_pos >= m_dict.size())
         throw stop_iteration_exception();
 
-    auto key = memory_manager().create_string(m_it->first);
+    auto key = memory_manager().create_string(m_dict.key(m_pos));
     auto t = memory_manager().create_tuple();
     t->append(key);
-    t->append(m_it->second);
-    m_it++;
+    t->append(m_dict.value(m_pos));
+    m_pos++;
     return t;
 }
 
@@ -28,7 +99,7 @@ ValuePtr DictItemIterator::duplicate(MemoryManager &mem)
 }
 
 DictKeyIterator::DictKeyIterator(MemoryManager &mem, Dictionary &dict)
-: Generator(mem), m_dict(dict), m_it(dict.elements().begin())
+: Generator(mem), m_dict(dict), m_pos(0)
 {
 }
 
@@ -36,12 +107,12 @@ DictItemsPtr Dictionary::items() { return make_value<DictItems>(memory_manager()
 
 ValuePtr DictKeyIterator::next()
 {
-    if(m_it == m_dict.elements().end())
+    if(m_pos >= m_dict.size())
         throw stop_iteration_exception();
 
     // FIXME implement tuples
-    auto &elem = m_it->second;
-    m_it++;
+    auto &elem = m_dict.value(m_pos);
+    m_pos++;
     return elem;
 }
 
@@ -60,27 +131,140 @@ IteratorPtr DictItems::iterate()
     return wrap_value(new(memory_manager()) DictItemIterator(memory_manager(), m_dict));
 }
 
-const std::map<std::string, ValuePtr> &Dictionary::elements() const { return m_elements; }
+Dictionary::~Dictionary()
+{
+    for(uint32_t i = 0; i < m_size; ++i)
+    {
+        if(m_entries[i].key != nullptr)
+        {
+            memory_manager().free(m_entries[i].key);
+        }
 
-std::map<std::string, ValuePtr> &Dictionary::elements() { return m_elements; }
+        m_entries[i].~Entry();
+    }
+}
 
-uint32_t Dictionary::size() const { return m_elements.size(); }
+uint32_t Dictionary::size() const { return m_size; }
 
 IteratorPtr Dictionary::iterate()
 {
     return wrap_value(new(memory_manager()) DictKeyIterator(memory_manager(), *this));
 }
 
+size_t Dictionary::key_hash(const std::string &key)
+{
+    // chosen once per process, the order of the elements does not depend on it
+    static const auto secret = []() {
+        std::random_device random;
+        std::array<uint64_t, 2> result;
+        for(auto &word : result)
+        {
+            word = (static_cast<uint64_t>(random()) << 32) | random();
+        }
+
+        return result;
+    }();
+
+    return sip_hash(secret, key);
+}
+
+size_t Dictionary::find_slot(const std::string &key, size_t hash) const
+{
+    auto mask = m_index.capacity() - 1;
+
+    // linear probing, the index is never full
+    for(auto slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        auto pos = m_index[slot];
+        if(pos == EMPTY)
+        {
+            return slot;
+        }
+
+        auto &entry = m_entries[pos];
+        if(entry.hash == hash && entry.key_size == key.size() &&
+           (key.empty() || memcmp(entry.key, key.data(), key.size()) == 0))
+        {
+            return slot;
+        }
+    }
+}
+
+void Dictionary::grow_index()
+{
+    auto capacity = std::max(MIN_INDEX_SIZE, m_index.capacity() * 2);
+
+    // build the new index on the side, so an allocation failure leaves the dictionary intact
+    SegmentedArray<uint32_t> index(memory_manager());
+    index.reserve(capacity, 0);
+
+    auto mask = capacity - 1;
+    for(size_t slot = 0; slot < capacity; ++slot)
+    {
+        index[slot] = EMPTY;
+    }
+
+    for(uint32_t pos = 0; pos < m_size; ++pos)
+    {
+        auto slot = m_entries[pos].hash & mask;
+        while(index[slot] != EMPTY)
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        index[slot] = pos;
+    }
+
+    m_index.swap(index);
+}
+
 ValuePtr Dictionary::get(const std::string &key)
 {
-    auto it = m_elements.find(key);
-    if(it == m_elements.end())
+    if(m_size == 0)
         return nullptr;
 
-    return it->second;
+    auto pos = m_index[find_slot(key, key_hash(key))];
+    if(pos == EMPTY)
+        return nullptr;
+
+    return m_entries[pos].value;
 }
 
-void Dictionary::insert(const std::string &key, ValuePtr value) { m_elements[key] = value; }
+void Dictionary::insert(const std::string &key, ValuePtr value)
+{
+    auto hash = key_hash(key);
+
+    if(m_size > 0)
+    {
+        auto pos = m_index[find_slot(key, hash)];
+        if(pos != EMPTY)
+        {
+            m_entries[pos].value = value;
+            return;
+        }
+    }
+
+    // keep at most two thirds of the slots in use
+    if((m_size + 1) * 3 > m_index.capacity() * 2)
+    {
+        grow_index();
+    }
+
+    m_entries.reserve(m_size + 1, m_size);
+
+    // the key is copied last, so nothing has to be undone if there is no memory left for it
+    char *key_copy = nullptr;
+    if(!key.empty())
+    {
+        key_copy = static_cast<char *>(memory_manager().malloc(key.size()));
+        memcpy(key_copy, key.data(), key.size());
+    }
+
+    auto slot = find_slot(key, hash);
+    new(&m_entries[m_size]) Entry{ hash, key_copy, static_cast<uint32_t>(key.size()), value };
+    m_index[slot] = m_size;
+    m_size++;
+}
 
 ValueType Dictionary::type() const { return ValueType::Dictionary; }
 
@@ -88,9 +272,9 @@ ValuePtr Dictionary::duplicate(MemoryManager &mem)
 {
     auto d = wrap_value(new(mem) Dictionary(mem));
 
-    for(auto &it : m_elements)
+    for(uint32_t i = 0; i < m_size; ++i)
     {
-        d->insert(it.first, it.second);
+        d->insert(key(i), m_entries[i].value);
     }
 
     return d;
@@ -100,10 +284,7 @@ ValuePtr Dictionary::duplicate(MemoryManager &mem)
 void Dictionary::apply(const std::string &key, ValuePtr value, BinaryOpType op)
 {
 
-    ValuePtr target = nullptr;
-    auto it = m_elements.find(key);
-    if(it != m_elements.end())
-        target = it->second;
+    ValuePtr target = get(key);
 
     if(!value || (target != nullptr && target->type() != ValueType::Integer) || value->type() != ValueType::Integer)
     {
@@ -117,13 +298,13 @@ void Dictionary::apply(const std::string &key, ValuePtr value, BinaryOpType op)
         if(target == nullptr)
         {
             auto i_value = value_cast<IntVal>(value);
-            m_elements[key] = i_value;
+            insert(key, i_value);
         }
         else
         {
             auto i_target = value_cast<IntVal>(target);
             auto i_value = value_cast<IntVal>(value);
-            i_target->set(i_target->get() + i_value->get());
+            insert(key, memory_manager().create_integer(i_target->get() + i_value->get()));
         }
         break;
     }
@@ -132,14 +313,13 @@ void Dictionary::apply(const std::string &key, ValuePtr value, BinaryOpType op)
         if(target == nullptr)
         {
             auto i_value = value_cast<IntVal>(value);
-            i_value->set(-1 * i_value->get());
-            m_elements[key] = i_value;
+            insert(key, memory_manager().create_integer(-1 * i_value->get()));
         }
         else
         {
             auto i_target = value_cast<IntVal>(target);
             auto i_value = value_cast<IntVal>(value);
-            i_target->set(i_target->get() - i_value->get());
+            insert(key, memory_manager().create_integer(i_target->get() - i_value->get()));
         }
         break;
     }
@@ -147,14 +327,13 @@ void Dictionary::apply(const std::string &key, ValuePtr value, BinaryOpType op)
     {
         if(target == nullptr)
         {
-            auto zero = wrap_value(new(memory_manager()) IntVal(memory_manager(), 0));
-            m_elements[key] = zero;
+            insert(key, memory_manager().create_integer(0));
         }
         else
         {
             auto i_target = value_cast<IntVal>(target);
             auto i_value = value_cast<IntVal>(value);
-            i_target->set(i_target->get() + i_value->get());
+            insert(key, memory_manager().create_integer(i_target->get() + i_value->get()));
         }
         break;
     }
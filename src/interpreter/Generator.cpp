@@ -5,6 +5,43 @@
 namespace cow
 {
 
+namespace
+{
+
+constexpr int64_t MIN_SMALL_INT = -128;
+constexpr int64_t MAX_SMALL_INT = 1024;
+
+struct Immediates
+{
+    Immediates() : true_value(mem, true), false_value(mem, false)
+    {
+        ints.reserve(MAX_SMALL_INT - MIN_SMALL_INT + 1);
+
+        for(auto i = MIN_SMALL_INT; i <= MAX_SMALL_INT; ++i)
+        {
+            ints.emplace_back(mem, i);
+            ints.back().make_immortal();
+        }
+
+        true_value.make_immortal();
+        false_value.make_immortal();
+    }
+
+    // never used to allocate, immediates live outside of any memory manager
+    DummyMemoryManager mem;
+    std::vector<IntVal> ints;
+    BoolVal true_value, false_value;
+};
+
+Immediates &immediates()
+{
+    // intentionally leaked, handles may still point to it during static destruction
+    static auto *instance = new Immediates();
+    return *instance;
+}
+
+} // namespace
+
 TuplePtr MemoryManager::create_tuple() { return make_value<Tuple>(*this); }
 
 StringValPtr MemoryManager::create_string(const std::string &str)
@@ -12,14 +49,25 @@ StringValPtr MemoryManager::create_string(const std::string &str)
     return make_value<StringVal>(*this, str);
 }
 
-IntValPtr MemoryManager::create_integer(const int32_t value)
+StringValPtr MemoryManager::create_string(std::string &&str)
 {
+    return make_value<StringVal>(*this, std::move(str));
+}
+
+IntValPtr MemoryManager::create_integer(const int64_t value)
+{
+    if(value >= MIN_SMALL_INT && value <= MAX_SMALL_INT)
+    {
+        return IntValPtr(&immediates().ints[value - MIN_SMALL_INT]);
+    }
+
     return make_value<IntVal>(*this, value);
 }
 
 BoolValPtr MemoryManager::create_boolean(const bool value)
 {
-    return make_value<BoolVal>(*this, value);
+    auto &imm = immediates();
+    return BoolValPtr(value ? &imm.true_value : &imm.false_value);
 }
 
 DictionaryPtr MemoryManager::create_dictionary() { return make_value<Dictionary>(*this); }
@@ -29,7 +77,7 @@ FloatValPtr MemoryManager::create_float(const double &value)
     return make_value<FloatVal>(*this, value);
 }
 
-ValuePtr MemoryManager::create_none() { return std::shared_ptr<Value>{ nullptr }; }
+ValuePtr MemoryManager::create_none() { return nullptr; }
 
 ListPtr MemoryManager::create_list() { return make_value<List>(*this); }
 
@@ -15,130 +15,122 @@
 #include <memory>
 #include <sstream>
 
-bool devmode = false;
-bool contractmode = false;
-
-
 namespace cow
 {
 
+ExecutionContext &ExecutionContext::global()
+{
+    static ExecutionContext context;
+    return context;
+}
+
+// bitstream can only hand out a copy of its buffer, so it's the only copy that is made
+static ProgramPtr decode_program(const bitstream &data)
+{
+    auto code = data.store();
+    return std::make_shared<Program>(bitstream_view(code));
+}
 
 Interpreter::Interpreter(const bitstream &data, MemoryManager &mem)
-: m_mem(mem), m_num_execution_steps(0), m_execution_step_limit(0), m_data(data)
+: Interpreter(decode_program(data), 0, mem)
 {
-    do_not_free_scope = false;
-    m_global_scope = new(memory_manager()) Scope(memory_manager());
+}
 
-    // add persistent store to interpreter
-    store = std::make_shared<PersistableDictionary>(mem);
-    m_global_scope->set_value("store", store);
+Interpreter::Interpreter(bitstream_view data, MemoryManager &mem)
+: Interpreter(std::make_shared<Program>(data), 0, mem)
+{
 }
 
 Interpreter::Interpreter(const bitstream &data, MemoryManager &mem, Interpreter &scope_borrower)
-: m_mem(mem), m_num_execution_steps(0), m_execution_step_limit(0), m_data(data)
+: m_mem(mem), m_num_execution_steps(0), m_execution_step_limit(0),
+  m_program(decode_program(data)), m_pc(0)
 {
     store = scope_borrower.get_storage_pointer();
     do_not_free_scope = true;
     m_global_scope = scope_borrower.m_global_scope;
 }
 
+Interpreter::Interpreter(ProgramPtr program, uint32_t entry, MemoryManager &mem)
+: m_mem(mem), m_num_execution_steps(0), m_execution_step_limit(0), m_program(std::move(program)),
+  m_pc(entry)
+{
+    do_not_free_scope = false;
+    m_global_scope = new(memory_manager()) Scope(memory_manager(), m_program, 0);
+
+    // add persistent store to interpreter
+    store = make_value<PersistableDictionary>(mem);
+    m_global_scope->set_value("store", store);
+}
+
 Interpreter::~Interpreter()
 {
     if(!do_not_free_scope)
         delete m_global_scope;
 
-    // no need to free store: shared pointer will release it properly
+    // no need to free store: its ObjectPtr returns it to the memory manager
 }
 
 
-ValuePtr Interpreter::read_function_stub(Interpreter &inti)
+ValuePtr Interpreter::read_function_stub(Interpreter &inti, const Instruction &def)
 {
 
     LoopState dummy_loop_state = LoopState::None;
 
-    uint32_t total_stub_len;
-    NodeType type;
-
-
-    m_data >> total_stub_len;
-    m_data >> type;
-
-    if(type == NodeType::FunctionStart)
-    {
-
-        // cycle until we find FunctionStartDefaults (arg parsing)
-        uint32_t num_args = 0;
-        m_data >> num_args;
-
-        std::vector<std::string> args;
-        std::vector<ValuePtr> defaults;
-
-        for(uint32_t i = 0; i < num_args; ++i)
+    // stage at which the stub turned out to be broken while decoding it
+    auto check_stub = [this, &def](int32_t stage) {
+        if(def.fault == Fault::Stub && def.integer == stage)
         {
-            CHARGE_EXECUTION;
-            auto arg = read_name();
-            args.push_back(arg);
+            throw std::runtime_error(m_program->string(def.error));
         }
+    };
 
-        m_data >> type;
-        if(type != NodeType::FunctionStartDefaults)
-        {
-            throw std::runtime_error("Stop hacking the bytecode, you pathetic little worm!");
-        }
+    check_stub(0);
 
-        // cycle until we find FunctionStartDefaults (arg parsing)
-        uint32_t num_defaults = 0;
-        m_data >> num_defaults;
+    std::vector<ValuePtr> defaults;
 
-        if(num_defaults != num_args)
-        {
-            throw std::runtime_error("Stop hacking the bytecode, you pathetic little worm!");
-        }
+    // the parameters were resolved when decoding, the names only need to be checked
+    for(uint32_t i = 0; i < def.size; ++i)
+    {
+        CHARGE_EXECUTION;
+        read_name();
+    }
 
-        bool non_standard = false;
-        for(uint32_t i = 0; i < num_defaults; ++i)
-        {
-            CHARGE_EXECUTION;
-            auto arg = execute_next(inti.get_scope(), dummy_loop_state);
-            if(arg != nullptr)
-                non_standard = true;
-            if(arg == nullptr && non_standard)
-            {
-                throw std::runtime_error("Non-default argument follows default argument");
-            }
-            defaults.push_back(arg);
-        }
+    check_stub(1);
 
-        m_data >> type;
-        if(type != NodeType::FunctionStartStub)
+    bool non_standard = false;
+    for(uint32_t i = 0; i < def.size; ++i)
+    {
+        CHARGE_EXECUTION;
+        auto arg = execute_next(inti.get_scope(), dummy_loop_state);
+        if(arg != nullptr)
+            non_standard = true;
+        if(arg == nullptr && non_standard)
         {
-            throw std::runtime_error("Stop hacking the bytecode, you pathetic little worm!");
+            throw std::runtime_error("Non-default argument follows default argument");
         }
+        defaults.push_back(arg);
+    }
 
+    check_stub(2);
 
-        std::string stub = m_data.Read(total_stub_len);
-        bitstream innerfunction(stub);
-
-        m_data >> type;
-
-        if(type != NodeType::FunctionEnd)
-        {
-            throw std::runtime_error(
-            "Are you kidding me, you stupid script kiddy? [wrong type order]");
-        }
+    // the body was decoded along with the rest of the program, so just jump over it
+    m_pc = def.end;
 
-        ValuePtr pcl = wrap_value<CallableVMFunction>(
-        new(memory_manager()) CallableVMFunction(memory_manager(), innerfunction, args, defaults));
-        return pcl;
-    }
-    else
-        throw std::runtime_error("Are you kidding me, you stupid script kiddy? [coder is insane]");
+    ValuePtr pcl = wrap_value<CallableVMFunction>(new(memory_manager()) CallableVMFunction(
+    memory_manager(), m_program, m_program->function(def.frame), std::move(defaults)));
+    return pcl;
 }
 
 void Interpreter::re_assign_bitstream(const bitstream &data)
 {
-    const std::string raw = data.store();
-    m_data.assign((uint8_t *)raw.data(), raw.size());
+    m_program = decode_program(data);
+    m_pc = 0;
+}
+
+void Interpreter::re_assign_bitstream(bitstream_view data)
+{
+    m_program = std::make_shared<Program>(data);
+    m_pc = 0;
 }
 
 ModulePtr Interpreter::get_module(const std::string &name)
@@ -150,7 +142,7 @@ ModulePtr Interpreter::get_module(const std::string &name)
         return it->second;
     }
 
-    std::shared_ptr<Module> module = nullptr;
+    ModulePtr module = nullptr;
 
     if(name == "rand")
     {
@@ -198,6 +190,31 @@ void Interpreter::set_execution_step_limit(uint32_t limit)
 
 void Interpreter::set_num_execution_steps(uint32_t current) { m_num_execution_steps = current; }
 
+void Interpreter::charge(uint32_t steps)
+{
+    if(m_execution_step_limit > 0 && steps > 0 &&
+       static_cast<uint64_t>(m_num_execution_steps) + steps >= m_execution_step_limit)
+    {
+        m_num_execution_steps = std::max(m_num_execution_steps + 1, m_execution_step_limit);
+        throw OutOfGasException();
+    }
+
+    m_num_execution_steps += steps;
+}
+
+void Interpreter::record_import(Scope &scope,
+                                Snapshot::Definition::Kind kind,
+                                const std::string &module,
+                                const std::string &member,
+                                const std::string &as_name)
+{
+    // only imports of the top level code end up in snapshots
+    if(&scope == m_global_scope)
+    {
+        m_definitions.push_back({ kind, Symbol(), nullptr, nullptr, module, member, as_name });
+    }
+}
+
 void Interpreter::load_module(Scope &scope, const std::string &mname, const std::string &as_name)
 {
     auto module = get_module(mname);
@@ -212,11 +229,8 @@ void Interpreter::load_module(Scope &scope, const std::string &mname, const std:
 
 ValuePtr Interpreter::calldata(std::string &data)
 {
-
-    ValuePtr val = nullptr;
-
     // try to read string first
-    bitstream argsbit(data);
+    bitstream_view argsbit(data);
     std::string function = "default";
     if(data.size() > 0)
         argsbit >> function;
@@ -260,8 +274,7 @@ ValuePtr Interpreter::calldata(std::string &data)
             {
                 int64_t arg;
                 argsbit >> arg;
-                auto argptr2 = wrap_value(new(memory_manager()) IntVal(memory_manager(), arg));
-                args.push_back(argptr2);
+                args.push_back(memory_manager().create_integer(arg));
                 break;
             }
             case 3:
@@ -276,8 +289,7 @@ ValuePtr Interpreter::calldata(std::string &data)
             {
                 bool arg;
                 argsbit >> arg;
-                auto argptr = wrap_value(new(memory_manager()) BoolVal(memory_manager(), arg));
-                args.push_back(argptr);
+                args.push_back(memory_manager().create_boolean(arg));
                 break;
             }
             default:
@@ -286,11 +298,26 @@ ValuePtr Interpreter::calldata(std::string &data)
             }
         }
     }
+    return call_value(callable, args, *m_global_scope);
+}
+
+ValuePtr Interpreter::call_value(const ValuePtr &callable, const std::vector<ValuePtr> &args, Scope &scope)
+{
+    // callers checked is_callable(), and only VM functions don't keep their steps
+    auto target = static_cast<Callable *>(callable.get());
+
+    if(!target->keeps_steps())
+    {
+        return call_function(*static_cast<const CallableVMFunction *>(target), args, scope);
+    }
+
     uint32_t current_num = num_execution_steps();
     uint32_t current_max = max_execution_steps();
+    ValuePtr val = nullptr;
+
     try
     {
-        val = value_cast<Callable>(callable)->call(args, *m_global_scope, current_num, current_max);
+        val = target->call(args, scope, current_num, current_max);
     }
     catch(...)
     {
@@ -302,6 +329,47 @@ ValuePtr Interpreter::calldata(std::string &data)
     return val;
 }
 
+ValuePtr Interpreter::call_function(const CallableVMFunction &function, const std::vector<ValuePtr> &args, Scope &scope)
+{
+    Scope body_scope(memory_manager(), scope, function.program(), function.frame());
+
+    // functions are only ever executed with a limit
+    if(m_execution_step_limit == 0)
+    {
+        throw std::runtime_error("Limit has to be larger than 0");
+    }
+
+    function.bind_arguments(body_scope, args);
+
+    m_frames.push_back(Frame{ std::move(m_program), m_pc });
+    m_program = function.program();
+    m_pc = function.entry();
+
+    LoopState loop_state = LoopState::None;
+    ValuePtr val = nullptr;
+
+    try
+    {
+        val = execute_next(body_scope, loop_state);
+    }
+    catch(...)
+    {
+        pop_frame();
+        throw;
+    }
+
+    pop_frame();
+    return val;
+}
+
+void Interpreter::pop_frame()
+{
+    auto &frame = m_frames.back();
+    m_program = std::move(frame.program);
+    m_pc = frame.pc;
+    m_frames.pop_back();
+}
+
 ValuePtr Interpreter::execute_in_scope(Scope &scope)
 {
     LoopState loop_state = LoopState::None;
@@ -311,91 +379,112 @@ ValuePtr Interpreter::execute_in_scope(Scope &scope)
 
 ValuePtr Interpreter::execute()
 {
+    const uint32_t start = m_num_execution_steps;
+    m_definitions.clear();
+    m_definitions_only = true;
+    m_initialized = false;
+
     LoopState loop_state = LoopState::None;
     ValuePtr val = execute_next(*m_global_scope, loop_state);
+
+    m_initialized = true;
+    m_top_level_steps = m_num_execution_steps - start;
     return val;
 }
 
-
-std::vector<std::string> Interpreter::read_names()
+SnapshotPtr Interpreter::snapshot() const
 {
-    std::vector<std::string> result;
-
-    NodeType type;
-    m_data >> type;
-    if(type == NodeType::Name)
+    if(!m_initialized || !m_definitions_only)
     {
-        std::string str;
-        m_data >> str;
-        result.push_back(str);
+        return nullptr;
     }
-    else if(type == NodeType::String)
+
+    return std::make_shared<Snapshot>(m_program, m_definitions, m_top_level_steps);
+}
+
+void Interpreter::restore(SnapshotPtr snapshot)
+{
+    if(snapshot->program() != m_program)
     {
-        std::string str;
-        m_data >> str;
-        result.push_back(str);
+        throw std::runtime_error("Snapshot was taken of another program");
     }
-    else if(type == NodeType::Tuple)
-    {
-        uint32_t num_elems = 0;
-        m_data >> num_elems;
 
-        if(num_elems != 2)
-            throw std::runtime_error("Can only name pairs");
+    charge(snapshot->num_execution_steps());
 
-        result.push_back(read_name());
-        result.push_back(read_name());
-    }
-    else
+    for(auto &definition : snapshot->definitions())
     {
-        throw std::runtime_error("Not a valid name [" + std::to_string((int)type) + "]");
+        switch(definition.kind)
+        {
+        case Snapshot::Definition::Kind::Function:
+            m_global_scope->set_value(definition.name, definition.function);
+            break;
+        case Snapshot::Definition::Kind::Import:
+            load_module(*m_global_scope, definition.module, definition.as_name);
+            break;
+        case Snapshot::Definition::Kind::ImportFrom:
+            load_from_module(
+            *m_global_scope, definition.module, definition.member, definition.as_name);
+            break;
+        }
     }
-    return result;
+
+    m_snapshot = std::move(snapshot);
 }
 
 
-std::string Interpreter::read_name()
+uint32_t Interpreter::read_symbols(Symbol symbols[2])
 {
-    NodeType type;
-    m_data >> type;
-    if(type == NodeType::Name)
-    {
-        std::string str;
-        m_data >> str;
-        return str;
-    }
-    else if(type == NodeType::String)
-    {
-        std::string str;
-        m_data >> str;
-        return str;
-    }
-    else
-        throw std::runtime_error("Not a valid name");
+    return m_program->read_symbols(m_pc, symbols);
 }
 
 
+const std::string &Interpreter::read_name() { return m_program->read_name(m_pc); }
+
+Symbol Interpreter::read_symbol() { return m_program->read_symbol(m_pc); }
+
+
 ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
 {
 
     CHARGE_EXECUTION;
 
-    auto start = m_data.pos();
+    const Program &program = *m_program;
+    const uint32_t start = m_pc;
+    const Instruction &node = program[start];
     ValuePtr returnval = nullptr;
 
-    NodeType type;
-    m_data >> type;
+    if(node.fault == Fault::Truncated)
+    {
+        throw std::runtime_error(program.string(node.error));
+    }
+
+    const NodeType type = node.type;
+    m_pc = start + 1;
 
     // disallow any type other than function definitions in top level
-    if(loop_state != LoopState::IgnoreAll && scope.get_depth() == 0 && type != NodeType::FunctionDef &&
-       type != NodeType::StatementList && type != NodeType::ImportFrom &&
-       type != NodeType::Import && type != NodeType::Alias && type != NodeType::Pass)
+    if(scope.get_depth() == 0 && type != NodeType::FunctionDef && type != NodeType::StatementList &&
+       type != NodeType::ImportFrom && type != NodeType::Import && type != NodeType::Alias &&
+       type != NodeType::Pass)
     {
-        throw std::runtime_error("Wrong code: you have to put all program logic into functions, no "
-                                 "code execution on the top level allowed. [" +
-                                 std::to_string((int)type) + "]");
+        if(loop_state != LoopState::IgnoreAll)
+        {
+            throw std::runtime_error("Wrong code: you have to put all program logic into "
+                                     "functions, no code execution on the top level allowed. [" +
+                                     std::to_string((int)type) + "]");
+        }
+
+        // the operand of an import is evaluated without the check, it can run any code
+        m_definitions_only = false;
     }
 
+    if(node.fault == Fault::UnknownType || node.fault == Fault::Opaque)
+    {
+        throw std::runtime_error("Unknown node type!");
+    }
+    else if(node.fault == Fault::Malformed)
+    {
+        throw std::runtime_error(program.string(node.error));
+    }
 
     LoopState dummy_loop_state = LoopState::None;
     LoopState ignore_all_state = LoopState::IgnoreAll;
@@ -403,7 +492,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     {
     case NodeType::ImportFrom:
     {
-        auto module = read_name();
+        auto &module = read_name();
 
         auto val = execute_next(scope, ignore_all_state);
         ASSERT_GENERIC(val);
@@ -416,22 +505,23 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
             {
                 auto alias = value_cast<Alias>(t->get(i));
                 load_from_module(scope, module, alias->name(), alias->as_name());
+                record_import(scope, Snapshot::Definition::Kind::ImportFrom, module,
+                              alias->name(), alias->as_name());
             }
         }
         else
         {
             auto alias = value_cast<Alias>(val);
             load_from_module(scope, module, alias->name(), alias->as_name());
+            record_import(scope, Snapshot::Definition::Kind::ImportFrom, module, alias->name(),
+                          alias->as_name());
         }
         break;
     }
     case NodeType::Tuple:
     {
-        uint32_t num_elems = 0;
-        m_data >> num_elems;
-
         auto tuple = wrap_value(new(memory_manager()) Tuple(memory_manager()));
-        for(uint32_t i = 0; i < num_elems; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
             auto val = execute_next(scope, dummy_loop_state);
@@ -449,13 +539,13 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
         ASSERT_GENERIC(val);
         auto alias = value_cast<Alias>(val);
         load_module(scope, alias->name(), alias->as_name());
+        record_import(scope, Snapshot::Definition::Kind::Import, alias->name(), "", alias->as_name());
         break;
     }
     case NodeType::Alias:
     {
-        std::string name, as_name;
-        m_data >> name >> as_name;
-        returnval = wrap_value(new(memory_manager()) Alias(memory_manager(), name, as_name));
+        returnval = wrap_value(new(memory_manager()) Alias(
+        memory_manager(), program.string(node.name), program.string(node.as_name)));
         break;
     }
     case NodeType::Pass:
@@ -466,21 +556,20 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     {
         ValuePtr value = execute_next(scope, dummy_loop_state);
         ASSERT_GENERIC(value);
-        std::string name = read_name();
+        auto &name = read_name();
         returnval = value->get_member(name);
         break;
     }
     case NodeType::Name:
     {
-        std::string str;
-        m_data >> str;
+        auto symbol = program.symbol(node);
 
-        if(str == "False")
+        if(symbol.builtin == BuiltinName::False)
             returnval = memory_manager().create_boolean(false);
-        else if(str == "True")
+        else if(symbol.builtin == BuiltinName::True)
             returnval = memory_manager().create_boolean(true);
         else
-            returnval = scope.get_value(str);
+            returnval = scope.get_value(symbol);
         break;
     }
     case NodeType::Continue:
@@ -507,37 +596,42 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     {
         auto val = execute_next(scope, dummy_loop_state);
         ASSERT_GENERIC(val);
-        uint32_t num_targets = 0;
-        m_data >> num_targets;
-
+        if(node.fault == Fault::Late)
+        {
+            throw std::runtime_error(program.string(node.error));
+        }
 
-        for(uint32_t i = 0; i < num_targets; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
 
             // here we need to decide whether we are dealing with a "subscript expression" or pure
-            // constants for this, we use the "peek operator" '&'
-            NodeType lookAhead;
-            m_data &lookAhead;
+            // constants for this, we peek at the type of the next node
+            const Instruction &lookAhead = program[m_pc];
+            if(lookAhead.fault == Fault::Truncated)
+            {
+                throw std::runtime_error(program.string(lookAhead.error));
+            }
 
-            if(lookAhead == NodeType::Subscript)
+            if(lookAhead.type == NodeType::Subscript)
             {
-                // we found the subscript assignment, we need to remove the lookahead from m_data now! We do it quick and dirty
-                m_data >> lookAhead;
+                // we found the subscript assignment, step into it
+                m_pc += 1;
 
                 // Now we parse, and evaluate the subscript
                 // first, we evaluate the index of the parent variable, which may be a complex expresion
                 auto index = execute_in_scope(scope);
                 ASSERT_GENERIC(index);
                 // and now the subscript parent variable, which should always be a constant
-                auto sscr = read_name();
+                auto sscr = read_symbol();
 
                 // Now we do the assigment and check for the validity of the index!
                 // numeric for List and String for Dict!
                 auto obj = scope.get_value(sscr);
                 if(obj == nullptr)
                 {
-                    throw std::runtime_error("Array or dictionary '" + sscr + "' has not been defined.");
+                    throw std::runtime_error("Array or dictionary '" + sscr.str() +
+                                             "' has not been defined.");
                 }
                 if(obj->type() == ValueType::Dictionary || obj->type() == ValueType::PersistableDictionary)
                 {
@@ -547,12 +641,12 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                     }
                     if(obj->type() == ValueType::Dictionary)
                     {
-                        std::shared_ptr<Dictionary> unwrapped = value_cast<Dictionary>(obj);
+                        DictionaryPtr unwrapped = value_cast<Dictionary>(obj);
                         unwrapped->insert(index->str(), val);
                     }
                     else
                     {
-                        std::shared_ptr<PersistableDictionary> unwrapped =
+                        PersistableDictionaryPtr unwrapped =
                         value_cast<PersistableDictionary>(obj);
                         unwrapped->insert(index->str(), val);
                     }
@@ -563,23 +657,24 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                     {
                         throw std::runtime_error("Array indices must be of type 'Integer'");
                     }
-                    std::shared_ptr<List> unwrapped = value_cast<List>(obj);
+                    ListPtr unwrapped = value_cast<List>(obj);
                     int64_t i = (int64_t)value_cast<IntVal>(index)->get();
                     unwrapped->set(i, val);
                 }
                 else
                 {
-                    throw std::runtime_error("Variable '" + sscr + "' is not an array or dictionary.");
+                    throw std::runtime_error("Variable '" + sscr.str() +
+                                             "' is not an array or dictionary.");
                 }
             }
             else
             {
+                Symbol names[2];
+                auto num_names = read_symbols(names);
 
-                auto names = read_names();
-
-                if(names.size() == 1)
+                if(num_names == 1)
                     scope.set_value(names[0], val);
-                else if(names.size() == 2)
+                else
                 {
                     if(val->type() == ValueType::Tuple)
                     {
@@ -591,39 +686,6 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                     else
                         throw std::runtime_error("cannot unpack value: not a tuple");
                 }
-                else if(names.size() == 3)
-                {
-                    auto dict = names[2];
-                    auto subscript = names[1];
-                    ValuePtr obj = scope.get_value(dict);
-                    ASSERT_GENERIC(obj);
-                    if(obj->type() == ValueType::Dictionary)
-                    {
-                        auto t = value_cast<Dictionary>(obj);
-                        t->insert(subscript, val);
-                    }
-                    else if(obj->type() == ValueType::PersistableDictionary)
-                    {
-                        std::cout << "AAHAHAHAHAA " << dict << "{" << subscript << "}"
-                                  << " PTR" << obj->type() << std::endl;
-
-                        auto t = value_cast<PersistableDictionary>(obj);
-                        t->insert(subscript, val);
-                    }
-                    else if(obj->type() == ValueType::List)
-                    {
-                        auto t = value_cast<List>(obj);
-                    }
-                    else
-                    {
-                        throw std::runtime_error(
-                        "subscript assigning only supported by array and dict");
-                    }
-                }
-                else
-                {
-                    throw std::runtime_error("invalid number of names");
-                }
             }
         }
 
@@ -631,25 +693,20 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::Global:
     {
-        uint32_t size = 0;
-        m_data >> size;
-        for(uint32_t i = 0; i < size; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
 
-            auto name = read_name();
+            auto name = read_symbol();
             scope.set_global_tag(name);
         }
         break;
     }
     case NodeType::StatementList:
     {
-        uint32_t size = 0;
-        m_data >> size;
-
         ValuePtr final = nullptr;
 
-        for(uint32_t i = 0; i < size; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
 
@@ -679,8 +736,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::UnaryOp:
     {
-        UnaryOpType type;
-        m_data >> type;
+        auto type = static_cast<UnaryOpType>(node.op);
 
         auto res = execute_next(scope, dummy_loop_state);
         ASSERT_GENERIC(res);
@@ -705,7 +761,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
             switch(type)
             {
             case UnaryOpType::Sub:
-                returnval = memory_manager().create_integer((-1) * i);
+                returnval = memory_manager().create_integer(static_cast<int32_t>((-1) * i));
                 break;
             case UnaryOpType::Add:
                 returnval = res;
@@ -733,9 +789,8 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::BoolOp:
     {
-        BoolOpType type;
-        uint32_t num_vals = 0;
-        m_data >> type >> num_vals;
+        auto type = static_cast<BoolOpType>(node.op);
+        const uint32_t num_vals = node.size;
 
         bool res;
 
@@ -801,8 +856,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::BinaryOp:
     {
-        BinaryOpType type;
-        m_data >> type;
+        auto type = static_cast<BinaryOpType>(node.op);
 
         auto left = execute_next(scope, dummy_loop_state);
         auto right = execute_next(scope, dummy_loop_state);
@@ -817,7 +871,8 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 auto i1 = value_cast<IntVal>(left)->get();
                 auto i2 = value_cast<IntVal>(right)->get();
 
-                returnval = memory_manager().create_integer(i1 + i2);
+                // results of binary operations wrap around at 32 bits
+                returnval = memory_manager().create_integer(static_cast<int32_t>(i1 + i2));
             }
             else if(left->type() == ValueType::String && right->type() == ValueType::String)
             {
@@ -843,7 +898,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 auto i1 = value_cast<IntVal>(left)->get();
                 auto i2 = value_cast<IntVal>(right)->get();
 
-                returnval = memory_manager().create_integer(i1 * i2);
+                returnval = memory_manager().create_integer(static_cast<int32_t>(i1 * i2));
             }
             else
                 throw std::runtime_error("failed to multiply");
@@ -860,7 +915,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 if(i2 == 0)
                     throw std::runtime_error("division by zero");
 
-                returnval = memory_manager().create_integer(i1 / i2);
+                returnval = memory_manager().create_integer(static_cast<int32_t>(i1 / i2));
             }
             else if(left->type() == ValueType::Float && right->type() == ValueType::Float)
             {
@@ -884,7 +939,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 auto i2 = value_cast<IntVal>(right)->get();
                 if(i2 == 0)
                     throw std::runtime_error("modulus by zero");
-                returnval = memory_manager().create_integer(i1 % i2);
+                returnval = memory_manager().create_integer(static_cast<int32_t>(i1 % i2));
             }
             else
                 throw std::runtime_error("failed apply mod function");
@@ -900,7 +955,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 auto i1 = value_cast<IntVal>(left)->get();
                 auto i2 = value_cast<IntVal>(right)->get();
 
-                returnval = memory_manager().create_integer(i1 - i2);
+                returnval = memory_manager().create_integer(static_cast<int32_t>(i1 - i2));
             }
             else
                 throw std::runtime_error("failed to sub");
@@ -921,10 +976,8 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     case NodeType::List:
     {
         auto list = memory_manager().create_list();
-        uint32_t size = 0;
-        m_data >> size;
 
-        for(uint32_t i = 0; i < size; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
             auto res = execute_next(scope, dummy_loop_state);
@@ -937,24 +990,21 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::String:
     {
-        std::string str;
-        m_data >> str;
-
-        returnval = memory_manager().create_string(str);
+        returnval = memory_manager().create_string(program.string(node.name));
         break;
     }
     case NodeType::Compare:
     {
         auto current = execute_next(scope, dummy_loop_state);
+        if(node.fault == Fault::Late)
+        {
+            throw std::runtime_error(program.string(node.error));
+        }
 
-        uint32_t size = 0;
-        m_data >> size;
-
-        for(uint32_t i = 0; i < size; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
-            CompareOpType op_type;
-            m_data >> op_type;
+            CompareOpType op_type = program.compare_op(node.operand + i);
 
             ValuePtr rval = execute_next(scope, dummy_loop_state);
             bool res = false;
@@ -1033,9 +1083,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::Integer:
     {
-        int32_t val;
-        m_data >> val;
-        returnval = memory_manager().create_integer(val);
+        returnval = memory_manager().create_integer(node.integer);
         break;
     }
     case NodeType::Call:
@@ -1046,30 +1094,29 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
         {
             throw std::runtime_error("Cannot call un-callable!");
         }
-
-        uint32_t num_args = 0;
-        m_data >> num_args;
+        if(node.fault == Fault::Late)
+        {
+            throw std::runtime_error(program.string(node.error));
+        }
 
         std::vector<ValuePtr> args;
-        for(uint32_t i = 0; i < num_args; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
             auto arg = execute_next(scope, dummy_loop_state);
             args.push_back(arg);
         }
 
-        uint32_t current_num = num_execution_steps();
-        uint32_t current_max = max_execution_steps();
-        try
-        {
-            returnval = value_cast<Callable>(callable)->call(args, scope, current_num, current_max);
-        }
-        catch(...)
+        // steps taken inside VM functions are not charged to the caller; steps native callables
+        // charge for their input are
+        bool keeps_steps = static_cast<const Callable *>(callable.get())->keeps_steps();
+        auto num_steps = num_execution_steps();
+        returnval = call_value(callable, args, scope);
+
+        if(!keeps_steps)
         {
-            set_num_execution_steps(current_num);
-            throw;
+            set_num_execution_steps(num_steps);
         }
-
         break;
     }
     case NodeType::If:
@@ -1118,13 +1165,10 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     {
         auto res = memory_manager().create_dictionary();
 
-        uint32_t size;
-        m_data >> size;
-
-        for(uint32_t i = 0; i < size; ++i)
+        for(uint32_t i = 0; i < node.size; ++i)
         {
             CHARGE_EXECUTION;
-            auto name = read_name();
+            auto &name = read_name();
             auto value = execute_next(scope, dummy_loop_state);
             ASSERT_GENERIC(value);
 
@@ -1166,12 +1210,12 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     case NodeType::WhileLoop:
     {
         LoopState for_loop_state = LoopState::TopLevel;
-        auto start = m_data.pos();
+        const uint32_t test_pos = m_pc;
 
         while(!scope.is_terminated() && for_loop_state != LoopState::Break)
         {
             CHARGE_EXECUTION;
-            m_data.move_to(start);
+            m_pc = test_pos;
 
             auto test = execute_next(scope, dummy_loop_state);
             bool cond = test && test->bool_test();
@@ -1181,13 +1225,12 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 break;
             }
 
-            Scope body_scope(memory_manager(), scope);
-            auto res = execute_next(body_scope, for_loop_state);
+            // the body shares the frame's slots, so it runs in the same scope
+            auto res = execute_next(scope, for_loop_state);
 
             // Propagate return?
-            if(body_scope.is_terminated())
+            if(scope.is_terminated())
             {
-                scope.terminate();
                 returnval = res;
             }
         }
@@ -1197,7 +1240,8 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::ForLoop:
     {
-        const std::vector<std::string> names = read_names();
+        Symbol names[2];
+        const uint32_t num_names = read_symbols(names);
         LoopState for_loop_state = LoopState::TopLevel;
 
         auto obj = execute_next(scope, dummy_loop_state);
@@ -1221,7 +1265,6 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
         while(!scope.is_terminated() && for_loop_state != LoopState::Break)
         {
             CHARGE_EXECUTION;
-            Scope body_scope(memory_manager(), scope);
             ValuePtr next = nullptr;
 
             try
@@ -1233,11 +1276,11 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 break;
             }
 
-            if(names.size() == 1)
+            if(num_names == 1)
             {
-                body_scope.set_value(names[0], next);
+                scope.set_value(names[0], next);
             }
-            else if(names.size() == 2)
+            else
             {
                 auto t = value_cast<Tuple>(next);
                 if(!t)
@@ -1245,20 +1288,15 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                     throw std::runtime_error("Cannot unpack values: not a tuple!");
                 }
 
-                body_scope.set_value(names[0], t->get(0));
-                body_scope.set_value(names[1], t->get(1));
-            }
-            else
-            {
-                throw std::runtime_error("Cannot handle more than two names");
+                scope.set_value(names[0], t->get(0));
+                scope.set_value(names[1], t->get(1));
             }
 
-            auto res = execute_next(body_scope, for_loop_state);
+            auto res = execute_next(scope, for_loop_state);
 
             // Propagate return?
-            if(body_scope.is_terminated())
+            if(scope.is_terminated())
             {
-                scope.terminate();
                 returnval = res;
             }
         }
@@ -1268,27 +1306,33 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
     case NodeType::ListComp:
     {
-        auto body_pos = m_data.pos();
+        const uint32_t body_pos = m_pc;
         skip_next();
 
-        uint32_t num_loops = 0;
-        m_data >> num_loops;
+        if(node.fault == Fault::Late)
+        {
+            throw std::runtime_error(program.string(node.error));
+        }
 
-        if(num_loops != 1)
+        if(node.size != 1)
         {
             throw std::runtime_error("Only simple list comprehensions are supported");
         }
 
-        NodeType type2;
-        m_data >> type2;
+        const Instruction &comprehension = program[m_pc];
+        if(comprehension.fault == Fault::Truncated)
+        {
+            throw std::runtime_error(program.string(comprehension.error));
+        }
 
-        if(type2 != NodeType::Comprehension)
+        if(comprehension.type != NodeType::Comprehension)
         {
             throw std::runtime_error("invalid type");
         }
+        m_pc += 1;
 
         auto for_loop_state = LoopState::TopLevel;
-        auto target = read_name();
+        auto target = read_symbol();
         auto list = memory_manager().create_list();
 
         auto iter = value_cast<Iterator>(execute_next(scope, loop_state));
@@ -1297,7 +1341,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
         // no support for if statements yet
         skip_next();
 
-        auto end_pos = m_data.pos();
+        const uint32_t end_pos = m_pc;
 
         while(!scope.is_terminated() && for_loop_state != LoopState::Break)
         {
@@ -1313,39 +1357,40 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 break;
             }
 
-            Scope body_scope(memory_manager(), scope);
-            body_scope.set_value(target, next);
+            scope.set_value(target, next);
 
-            m_data.move_to(body_pos);
-            auto res = execute_next(body_scope, for_loop_state);
+            m_pc = body_pos;
+            auto res = execute_next(scope, for_loop_state);
             list->append(res);
         }
 
-        m_data.move_to(end_pos);
+        m_pc = end_pos;
         returnval = list;
         break;
     }
     case NodeType::AugmentedAssign:
     {
-        BinaryOpType op_type;
-        m_data >> op_type;
+        auto op_type = static_cast<BinaryOpType>(node.op);
 
         // here we need to decide whether we are dealing with a "subscript expression" or pure
-        // constants for this, we use the "peek operator" '&'
-        NodeType lookAhead;
-        m_data &lookAhead;
+        // constants for this, we peek at the type of the next node
+        const Instruction &lookAhead = program[m_pc];
+        if(lookAhead.fault == Fault::Truncated)
+        {
+            throw std::runtime_error(program.string(lookAhead.error));
+        }
 
-        if(lookAhead == NodeType::Subscript)
+        if(lookAhead.type == NodeType::Subscript)
         {
-            // we found the subscript assignment, we need to remove the lookahead from m_data now! We do it quick and dirty
-            m_data >> lookAhead;
+            // we found the subscript assignment, step into it
+            m_pc += 1;
 
             // Now we parse, and evaluate the subscript
             // first, we evaluate the index of the parent variable, which may be a complex expresion
             auto index = execute_in_scope(scope);
             ASSERT_GENERIC(index);
             // and now the subscript parent variable, which should always be a constant
-            auto sscr = read_name();
+            auto sscr = read_symbol();
 
 
             // Now we do the assigment and check for the validity of the index!
@@ -1354,7 +1399,7 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
             auto val = execute_next(scope, dummy_loop_state);
             if(obj == nullptr)
             {
-                throw std::runtime_error("Array or dictionary '" + sscr + "' has not been defined.");
+                throw std::runtime_error("Array or dictionary '" + sscr.str() + "' has not been defined.");
             }
             if(obj->type() == ValueType::Dictionary || obj->type() == ValueType::PersistableDictionary)
             {
@@ -1364,12 +1409,12 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 }
                 if(obj->type() == ValueType::Dictionary)
                 {
-                    std::shared_ptr<Dictionary> unwrapped = value_cast<Dictionary>(obj);
+                    DictionaryPtr unwrapped = value_cast<Dictionary>(obj);
                     unwrapped->apply(index->str(), val, op_type);
                 }
                 else
                 {
-                    std::shared_ptr<PersistableDictionary> unwrapped =
+                    PersistableDictionaryPtr unwrapped =
                     value_cast<PersistableDictionary>(obj);
                     unwrapped->apply(index->str(), val, op_type);
                 }
@@ -1380,77 +1425,78 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
                 {
                     throw std::runtime_error("Array indices must be of type 'Integer'");
                 }
-                std::shared_ptr<List> unwrapped = value_cast<List>(obj);
+                ListPtr unwrapped = value_cast<List>(obj);
                 int64_t i = (int64_t)value_cast<IntVal>(index)->get();
                 unwrapped->apply(i, val, op_type);
             }
             else
             {
-                throw std::runtime_error("Variable '" + sscr + "' is not an array or dictionary.");
+                throw std::runtime_error("Variable '" + sscr.str() + "' is not an array or dictionary.");
             }
         }
         else
         {
-            auto t_name = read_name();
+            auto t_name = read_symbol();
             auto target = scope.get_value(t_name);
 
             auto value = execute_next(scope, dummy_loop_state);
 
-            switch(op_type)
-            {
-            case BinaryOpType::Add:
+            if(op_type != BinaryOpType::Add && op_type != BinaryOpType::Sub &&
+               op_type != BinaryOpType::Mult)
             {
-                if(!target || !value || target->type() != ValueType::Integer || value->type() != ValueType::Integer)
-                {
-                    throw std::runtime_error("Values need to be numerics");
-                }
-
-                auto i_target = value_cast<IntVal>(target);
-                auto i_value = value_cast<IntVal>(value);
-                i_target->set(i_target->get() + i_value->get());
-                break;
+                throw std::runtime_error("Unknown binary op");
             }
-            case BinaryOpType::Sub:
-            {
-                if(!target || !value || target->type() != ValueType::Integer || value->type() != ValueType::Integer)
-                {
-                    throw std::runtime_error("Values need to be numerics");
-                }
 
-                auto i_target = value_cast<IntVal>(target);
-                auto i_value = value_cast<IntVal>(value);
-                i_target->set(i_target->get() - i_value->get());
-                break;
-            }
-            case BinaryOpType::Mult:
+            if(!target || !value || target->type() != ValueType::Integer || value->type() != ValueType::Integer)
             {
-                if(!target || !value || target->type() != ValueType::Integer || value->type() != ValueType::Integer)
-                {
-                    throw std::runtime_error("Values need to be numerics");
-                }
+                throw std::runtime_error("Values need to be numerics");
+            }
 
-                auto i_target = value_cast<IntVal>(target);
-                auto i_value = value_cast<IntVal>(value);
-                i_target->set(i_target->get() * i_value->get());
+            auto i_target = value_cast<IntVal>(target)->get();
+            auto i_value = value_cast<IntVal>(value)->get();
+            int64_t result;
+
+            switch(op_type)
+            {
+            case BinaryOpType::Add:
+                result = i_target + i_value;
+                break;
+            case BinaryOpType::Sub:
+                result = i_target - i_value;
                 break;
-            }
             default:
-                throw std::runtime_error("Unknown binary op");
+                result = i_target * i_value;
+                break;
             }
+
+            scope.update_value(t_name, memory_manager().create_integer(result));
         }
         break;
     }
     case NodeType::FunctionDef:
     {
-        auto t_name = read_name();
-        if(t_name.size() == 0)
+        auto t_name = read_symbol();
+        if(t_name.str().size() == 0)
             throw std::runtime_error("Function name of length zero");
 
         // Now, read the stub and get the stack jump point
-        ValuePtr jump_point = read_function_stub(*this);
+        ValuePtr jump_point = read_function_stub(*this, node);
         ASSERT_GENERIC(jump_point);
 
         scope.set_value(t_name, jump_point);
+
+        if(&scope == m_global_scope)
+        {
+            auto &function = static_cast<const CallableVMFunction &>(*jump_point);
+            m_definitions.push_back({ Snapshot::Definition::Kind::Function, t_name,
+                                      &function.code(), nullptr, "", "", "" });
+
+            // snapshots don't copy values, so default values can't be captured
+            for(auto &value : function.defaults())
+            {
+                m_definitions_only = m_definitions_only && value == nullptr;
+            }
+        }
         break;
     }
     default:
@@ -1458,190 +1504,27 @@ ValuePtr Interpreter::execute_next(Scope &scope, LoopState &loop_state)
     }
 
     if(loop_state != LoopState::Normal && loop_state != LoopState::None)
-        m_data.move_to(start);
+        m_pc = start;
 
     return returnval;
 }
 
 void Interpreter::skip_next()
 {
-    NodeType type;
-    m_data >> type;
-
-    switch(type)
-    {
-    case NodeType::Pass:
-    {
-        break;
-    }
-    case NodeType::Name:
-    {
-        std::string str;
-        m_data >> str;
-        break;
-    }
-    case NodeType::ForLoop:
-    {
-        read_names();
-        skip_next();
-        skip_next();
-        break;
-    }
-    case NodeType::WhileLoop:
-    {
-        skip_next();
-        skip_next();
-        break;
-    }
-    case NodeType::Assign:
-    {
-        skip_next();
-
-        uint32_t num_targets = 0;
-        m_data >> num_targets;
-
-        for(uint32_t i = 0; i < num_targets; ++i)
-        {
-            CHARGE_EXECUTION;
-            skip_next();
-        }
-        break;
-    }
-    case NodeType::StatementList:
-    {
-        uint32_t size = 0;
-        m_data >> size;
-
-        for(uint32_t i = 0; i < size; ++i)
-        {
-            CHARGE_EXECUTION;
-            skip_next();
-        }
-        break;
-    }
-    case NodeType::Index:
-    case NodeType::Return:
-    {
-        skip_next();
-        break;
-    }
-    case NodeType::String:
-    {
-        std::string str;
-        m_data >> str;
-        break;
-    }
-    case NodeType::Compare:
-    {
-        skip_next();
-        uint32_t size = 0;
-        m_data >> size;
+    // the cost of skipping a subtree is known from decoding it
+    const Instruction &node = (*m_program)[m_pc];
+    charge(node.skip_cost);
 
-        for(uint32_t i = 0; i < size; ++i)
-        {
-            CHARGE_EXECUTION;
-            CompareOpType op_type;
-            m_data >> op_type;
-            skip_next();
-        }
-        break;
-    }
-    case NodeType::Integer:
+    if(node.skip_error != Instruction::NO_ERROR)
     {
-        int32_t val;
-        m_data >> val;
-        break;
+        throw std::runtime_error(m_program->string(node.skip_error));
     }
-    case NodeType::Call:
-    {
-        skip_next();
-        uint32_t num_args = 0;
-        m_data >> num_args;
-        for(uint32_t i = 0; i < num_args; ++i)
-        {
-            CHARGE_EXECUTION;
-            skip_next();
-        }
-        break;
-    }
-    case NodeType::IfElse:
-    {
-        skip_next();
-        skip_next();
-        skip_next();
-        break;
-    }
-    case NodeType::List:
-    case NodeType::Tuple:
-    {
-        uint32_t size;
-        m_data >> size;
-        for(uint32_t i = 0; i < size; ++i)
-        {
-            CHARGE_EXECUTION;
-            skip_next();
-        }
 
-        break;
-    }
-    case NodeType::Dictionary:
-    {
-        uint32_t size;
-        m_data >> size;
-        for(uint32_t i = 0; i < size; ++i)
-        {
-            CHARGE_EXECUTION;
-            skip_next();
-            skip_next();
-        }
-        break;
-    }
-    case NodeType::UnaryOp:
-    {
-        UnaryOpType type;
-        m_data >> type;
-        skip_next();
-        break;
-    }
-    case NodeType::BoolOp:
-    {
-        BoolOpType op;
-        uint32_t num_vals = 0;
-        m_data >> op >> num_vals;
-
-        for(uint32_t i = 0l; i < num_vals; ++i)
-        {
-            CHARGE_EXECUTION;
-            skip_next();
-        }
-        break;
-    }
-    case NodeType::AugmentedAssign:
-    case NodeType::BinaryOp:
-    {
-        BinaryOpType op;
-        m_data >> op;
-        skip_next();
-        skip_next();
-        break;
-    }
-    case NodeType::If:
-    case NodeType::Attribute:
-    case NodeType::Subscript:
-    {
-        skip_next();
-        skip_next();
-        break;
-    }
-    case NodeType::Break:
-    case NodeType::Continue:
-        break;
-
-    default:
-        throw std::runtime_error("Failed to skip unknown node type!");
-    }
+    m_pc = node.end;
 }
 
+void Interpreter::set_context(ExecutionContext &context) { m_global_scope->set_context(context); }
+
 void Interpreter::set_module(const std::string &name, ModulePtr module)
 {
     m_loaded_modules[name] = module;
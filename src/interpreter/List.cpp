@@ -1,9 +1,35 @@
 #include <cowlang/Function.h>
 #include <cowlang/Interpreter.h>
 #include <cowlang/List.h>
+#include <cowlang/simd.h>
 namespace cow
 {
 
+List::List(MemoryManager &mem, const std::vector<int64_t> &integers)
+: List(mem)
+{
+    m_integers.reserve(integers.size(), 0);
+
+    for(size_t i = 0; i < integers.size(); ++i)
+    {
+        m_integers[i] = integers[i];
+    }
+
+    m_storage = Storage::Integers;
+    m_size = integers.size();
+}
+
+List::~List()
+{
+    if(m_storage == Storage::Boxed)
+    {
+        for(uint32_t i = 0; i < m_size; ++i)
+        {
+            m_boxed[i].~ValuePtr();
+        }
+    }
+}
+
 IteratorPtr List::iterate()
 {
     return wrap_value(new(memory_manager()) ListIterator(memory_manager(), *this));
@@ -13,9 +39,10 @@ ValuePtr List::duplicate(MemoryManager &mem)
 {
     auto d = wrap_value(new(mem) List(mem));
 
-    for(auto elem : m_elements)
+    // append to the copy, so the memory manager of the copy is charged for its elements
+    for(uint32_t i = 0; i < m_size; ++i)
     {
-        d->append(elem);
+        d->append(get(i));
     }
 
     return d;
@@ -51,7 +78,13 @@ ValuePtr List::get(int64_t index)
     }
     if(index < 0)
         index = size() + index;
-    return m_elements[index];
+
+    if(m_storage == Storage::Integers)
+        return memory_manager().create_integer(m_integers[index]);
+    else if(m_storage == Storage::Floats)
+        return memory_manager().create_float(m_floats[index]);
+    else
+        return m_boxed[index];
 }
 
 void List::set(int64_t index, ValuePtr val)
@@ -63,7 +96,17 @@ void List::set(int64_t index, ValuePtr val)
     if(index < 0)
         index = size() + index;
 
-    m_elements[index] = val;
+    auto type = val ? val->type() : ValueType::None;
+
+    if(m_storage == Storage::Integers && type == ValueType::Integer)
+        m_integers[index] = value_cast<IntVal>(val)->get();
+    else if(m_storage == Storage::Floats && type == ValueType::Float)
+        m_floats[index] = value_cast<FloatVal>(val)->get();
+    else
+    {
+        box();
+        m_boxed[index] = val;
+    }
 }
 
 void List::apply(int64_t index, ValuePtr value, BinaryOpType op)
@@ -75,7 +118,35 @@ void List::apply(int64_t index, ValuePtr value, BinaryOpType op)
     if(index < 0)
         index = size() + index;
 
-    auto target = m_elements[index];
+    if(m_storage == Storage::Integers)
+    {
+        if(!value || value->type() != ValueType::Integer)
+        {
+            throw std::runtime_error("Values need to be numerics");
+        }
+
+        auto &target = m_integers[index];
+        auto i_value = value_cast<IntVal>(value)->get();
+
+        switch(op)
+        {
+        case BinaryOpType::Add:
+            target = target + i_value;
+            break;
+        case BinaryOpType::Sub:
+            target = target - i_value;
+            break;
+        case BinaryOpType::Mult:
+            target = target * i_value;
+            break;
+        default:
+            throw std::runtime_error("Unknown binary op");
+        }
+
+        return;
+    }
+
+    auto target = get(index);
 
     if(!target || !value || target->type() != ValueType::Integer || value->type() != ValueType::Integer)
     {
@@ -88,21 +159,24 @@ void List::apply(int64_t index, ValuePtr value, BinaryOpType op)
     {
         auto i_target = value_cast<IntVal>(target);
         auto i_value = value_cast<IntVal>(value);
-        i_target->set(i_target->get() + i_value->get());
+        box();
+        m_boxed[index] = memory_manager().create_integer(i_target->get() + i_value->get());
         break;
     }
     case BinaryOpType::Sub:
     {
         auto i_target = value_cast<IntVal>(target);
         auto i_value = value_cast<IntVal>(value);
-        i_target->set(i_target->get() - i_value->get());
+        box();
+        m_boxed[index] = memory_manager().create_integer(i_target->get() - i_value->get());
         break;
     }
     case BinaryOpType::Mult:
     {
         auto i_target = value_cast<IntVal>(target);
         auto i_value = value_cast<IntVal>(value);
-        i_target->set(i_target->get() * i_value->get());
+        box();
+        m_boxed[index] = memory_manager().create_integer(i_target->get() * i_value->get());
         break;
     }
     default:
@@ -110,17 +184,73 @@ void List::apply(int64_t index, ValuePtr value, BinaryOpType op)
     }
 }
 
-uint32_t List::size() const { return m_elements.size(); }
+uint32_t List::size() const { return m_size; }
+
+const SegmentedArray<int64_t> *List::integers() const
+{
+    return m_storage == Storage::Integers ? &m_integers : nullptr;
+}
+
+void List::box()
+{
+    if(m_storage == Storage::Boxed)
+        return;
+
+    // box into a new array first, so running out of memory leaves the list intact
+    SegmentedArray<ValuePtr> boxed(memory_manager());
+    boxed.reserve(m_size, 0);
+
+    uint32_t i = 0;
+    try
+    {
+        for(; i < m_size; ++i)
+        {
+            new(&boxed[i]) ValuePtr(get(i));
+        }
+    }
+    catch(...)
+    {
+        while(i > 0)
+        {
+            boxed[--i].~ValuePtr();
+        }
+        throw;
+    }
 
-const std::vector<ValuePtr> &List::elements() const { return m_elements; }
+    m_boxed.swap(boxed);
+    m_integers.release();
+    m_floats.release();
+    m_storage = Storage::Boxed;
+}
 
 std::string List::str() const
 {
     std::string result = "[";
     bool first = true;
 
-    for(auto elem : m_elements)
+    // unboxed elements print like IntVal and FloatVal do
+    auto append_unboxed = [&](auto &elements) {
+        for(uint32_t i = 0; i < m_size; ++i)
+        {
+            result += (i == 0 ? "" : ", ") + std::to_string(elements[i]);
+        }
+    };
+
+    if(m_storage == Storage::Integers)
     {
+        append_unboxed(m_integers);
+        return result + ']';
+    }
+    else if(m_storage == Storage::Floats)
+    {
+        append_unboxed(m_floats);
+        return result + ']';
+    }
+
+    for(uint32_t i = 0; i < m_size; ++i)
+    {
+        auto &elem = m_boxed[i];
+
         if(first)
         {
             first = false;
@@ -153,8 +283,29 @@ std::string List::str() const
 
 bool List::contains(const Value &value) const
 {
-    for(auto elem : m_elements)
+    if(m_storage == Storage::Integers)
     {
+        if(value.type() != ValueType::Integer)
+            return false;
+
+        auto i_value = dynamic_cast<const IntVal &>(value).get();
+        bool found = false;
+
+        m_integers.for_each_run(m_size, [&](const int64_t *values, size_t count) {
+            found = found || simd::contains(values, count, i_value);
+        });
+
+        return found;
+    }
+    else if(m_storage == Storage::Floats)
+    {
+        // floats never compare equal, see operator==
+        return false;
+    }
+
+    for(uint32_t i = 0; i < m_size; ++i)
+    {
+        auto &elem = m_boxed[i];
         ASSERT_GENERIC(elem);
         if(*elem == value)
             return true;
@@ -165,7 +316,39 @@ bool List::contains(const Value &value) const
 
 ValueType List::type() const { return ValueType::List; }
 
-void List::append(ValuePtr val) { m_elements.push_back(val); }
+void List::append(ValuePtr val)
+{
+    auto type = val ? val->type() : ValueType::None;
+
+    if(m_size == 0)
+    {
+        if(type == ValueType::Integer)
+            m_storage = Storage::Integers;
+        else if(type == ValueType::Float)
+            m_storage = Storage::Floats;
+        else
+            m_storage = Storage::Boxed;
+    }
+
+    if(m_storage == Storage::Integers && type == ValueType::Integer)
+    {
+        m_integers.reserve(m_size + 1, m_size);
+        m_integers[m_size] = value_cast<IntVal>(val)->get();
+    }
+    else if(m_storage == Storage::Floats && type == ValueType::Float)
+    {
+        m_floats.reserve(m_size + 1, m_size);
+        m_floats[m_size] = value_cast<FloatVal>(val)->get();
+    }
+    else
+    {
+        box();
+        m_boxed.reserve(m_size + 1, m_size);
+        new(&m_boxed[m_size]) ValuePtr(val);
+    }
+
+    m_size += 1;
+}
 
 ListIterator::ListIterator(MemoryManager &mem, List &list) : Generator(mem), m_list(list), m_pos(0)
 {
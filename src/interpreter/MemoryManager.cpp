@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <cowlang/Object.h>
 #include <cowlang/execution_limits.h>
 
@@ -10,17 +13,151 @@ namespace cow
 
 size_t DEFAULT_MAXIMUM_HEAP_PAGES = 3;
 
-DefaultMemoryManager::DefaultMemoryManager() : m_buffer_pos(0)
+namespace
 {
-    uint8_t *buffer = (uint8_t *)::malloc(PAGE_SIZE);
-    m_buffers.push_back(buffer);
+
+constexpr uint32_t BLOCK_USED = 0x75736564; // "used"
+constexpr uint32_t BLOCK_FREE = 0x66726565; // "free"
+
+uint8_t *allocate_page()
+{
+    constexpr auto size = PagePool::PAGE_SIZE;
+    auto page = reinterpret_cast<uint8_t *>(std::aligned_alloc(size, size));
+
+    if(page == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return page;
+}
+
+} // namespace
+
+PagePool &PagePool::instance()
+{
+    // intentionally leaked, memory managers may return pages during static destruction
+    static auto *pool = new PagePool();
+    return *pool;
+}
+
+uint8_t *PagePool::acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(!m_pages.empty())
+        {
+            auto page = m_pages.back();
+            m_pages.pop_back();
+            return page;
+        }
+    }
+
+    return allocate_page();
+}
+
+void PagePool::release(uint8_t *page)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_pages.size() >= m_max_pages)
+    {
+        lock.unlock();
+        ::free(page);
+        return;
+    }
+
+    auto scrub = m_scrub;
+    lock.unlock();
+
+    if(scrub == Scrub::Zero)
+    {
+        memset(page, 0, PAGE_SIZE);
+    }
+    else if(scrub == Scrub::Poison)
+    {
+        memset(page, 0xde, PAGE_SIZE);
+    }
+
+    lock.lock();
+
+    // others may have returned pages while this one was scrubbed
+    if(m_pages.size() >= m_max_pages)
+    {
+        lock.unlock();
+        ::free(page);
+        return;
+    }
+
+    m_pages.push_back(page);
+}
+
+void PagePool::reserve(size_t num_pages)
+{
+    while(size() < num_pages)
+    {
+        auto page = allocate_page();
+
+        // touch every page so it is mapped already
+        memset(page, 0, PAGE_SIZE);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pages.push_back(page);
+    }
+}
+
+void PagePool::set_scrub(Scrub scrub)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scrub = scrub;
+}
+
+PagePool::Scrub PagePool::scrub() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_scrub;
+}
+
+void PagePool::set_max_pages(size_t max_pages)
+{
+    std::vector<uint8_t *> surplus;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_max_pages = max_pages;
+
+        while(m_pages.size() > m_max_pages)
+        {
+            surplus.push_back(m_pages.back());
+            m_pages.pop_back();
+        }
+    }
+
+    for(auto page : surplus)
+    {
+        ::free(page);
+    }
+}
+
+size_t PagePool::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pages.size();
+}
+
+DefaultMemoryManager::DefaultMemoryManager()
+: m_buffer_pos(0), m_max_pages(DEFAULT_MAXIMUM_HEAP_PAGES)
+{
+    add_page();
+    m_free_lists.fill(nullptr);
 }
 
 DefaultMemoryManager::~DefaultMemoryManager()
 {
     for(auto buffer : m_buffers)
     {
-        ::free(buffer);
+        PagePool::instance().release(buffer);
     }
 }
 
@@ -34,94 +171,203 @@ const uint32_t DummyMemoryManager::get_mem() { return 0; }
 
 const uint32_t DefaultMemoryManager::get_max_mem()
 {
-    return DEFAULT_MAXIMUM_HEAP_PAGES * PAGE_SIZE;
+    return m_max_pages * PAGE_SIZE;
 };
 const uint32_t DefaultMemoryManager::get_mem() { return m_buffer_pos; };
 
-void *DefaultMemoryManager::assign_alloc(size_t page_no, size_t poffset, size_t size)
+uint32_t DefaultMemoryManager::size_class(size_t size)
 {
-    if(poffset + size > PAGE_SIZE)
+    if(size <= NUM_SMALL_CLASSES * SMALL_CLASS_STEP)
     {
-        throw std::runtime_error("Invalid offset");
+        return size == 0 ? 0 : (size - 1) / SMALL_CLASS_STEP;
     }
 
-    auto ptr = reinterpret_cast<uint8_t *>(&m_buffers[page_no][poffset]);
-    auto idx = reinterpret_cast<intptr_t>(ptr);
+    uint32_t size_class = NUM_SMALL_CLASSES;
+    size_t max_size = NUM_SMALL_CLASSES * SMALL_CLASS_STEP * 2;
 
-    m_allocs.emplace(idx, AllocInfo{ page_no, size });
-    return ptr;
+    while(max_size < size)
+    {
+        max_size *= 2;
+        size_class += 1;
+    }
+
+    return size_class;
 }
 
-void *DefaultMemoryManager::malloc(size_t size)
+size_t DefaultMemoryManager::class_size(uint32_t size_class)
 {
-    if(size >= PAGE_SIZE)
+    if(size_class < NUM_SMALL_CLASSES)
     {
-        throw std::runtime_error("cannot allocate more than page size");
+        return (size_class + 1) * SMALL_CLASS_STEP;
     }
 
-    uint32_t buf_pos = 0;
-    for(auto buffer : m_buffers)
+    // the largest class has to fit into a page, including its header
+    auto size = (NUM_SMALL_CLASSES * SMALL_CLASS_STEP) << (size_class - NUM_SMALL_CLASSES + 1);
+    return std::min(size, PAGE_SIZE - sizeof(BlockHeader));
+}
+
+void DefaultMemoryManager::add_page()
+{
+    auto page = PagePool::instance().acquire();
+
+    try
+    {
+        m_page_numbers.emplace(page, m_buffers.size());
+        m_block_starts.resize((m_buffers.size() + 1) * BITMAP_WORDS_PER_PAGE, 0);
+        m_buffers.push_back(page);
+    }
+    catch(...)
     {
-        auto last_pos = 0;
+        m_page_numbers.erase(page);
+        PagePool::instance().release(page);
+        throw;
+    }
+}
 
-        for(auto &[ptr, a] : m_allocs)
-        {
-            if(buf_pos != a.page)
-            {
-                continue;
-            }
+size_t DefaultMemoryManager::block_bit(const void *ptr) const
+{
+    auto addr = reinterpret_cast<uintptr_t>(ptr);
+    auto page = reinterpret_cast<const uint8_t *>(addr & ~(PAGE_SIZE - 1));
+    auto offset = addr - reinterpret_cast<uintptr_t>(page);
 
-            auto start = ptr - reinterpret_cast<size_t>(buffer);
-            auto s = static_cast<size_t>(start - last_pos);
+    auto it = m_page_numbers.find(page);
+    if(it == m_page_numbers.end() || offset % sizeof(BlockHeader) != 0)
+    {
+        return SIZE_MAX;
+    }
 
-            if(s >= size)
-            {
-                return assign_alloc(buf_pos, last_pos, size);
-            }
+    return it->second * BITMAP_WORDS_PER_PAGE * 64 + offset / sizeof(BlockHeader);
+}
 
-            last_pos = start + a.size;
-        }
+void DefaultMemoryManager::set_block_bit(size_t bit, bool value)
+{
+    auto mask = uint64_t(1) << (bit % 64);
 
-        buf_pos += 1;
+    if(value)
+    {
+        m_block_starts[bit / 64] |= mask;
     }
+    else
+    {
+        m_block_starts[bit / 64] &= ~mask;
+    }
+}
 
-    auto buffer_size = m_buffers.size() * PAGE_SIZE;
+void *DefaultMemoryManager::pop_free(uint32_t size_class)
+{
+    auto ptr = m_free_lists[size_class];
 
-    if(m_buffer_pos + size >= buffer_size)
+    if(ptr != nullptr)
     {
+        m_free_lists[size_class] = *reinterpret_cast<void **>(ptr);
+        reinterpret_cast<BlockHeader *>(ptr)[-1].state = BLOCK_USED;
+        set_block_bit(block_bit(ptr), true);
+    }
+
+    return ptr;
+}
+
+void *DefaultMemoryManager::bump_alloc(uint32_t size_class)
+{
+    auto size = sizeof(BlockHeader) + class_size(size_class);
+    auto next_page = m_buffer_pos / PAGE_SIZE + 1;
 
+    if(m_buffer_pos + size >= next_page * PAGE_SIZE)
+    {
         // support execution limits: if the next page would shoot over the mem limits ... bail!
-        if(m_buffers.size() == DEFAULT_MAXIMUM_HEAP_PAGES)
-            throw std::runtime_error(
-            "out of memory: program tries to allocate too much heap memory!");
+        if(next_page >= m_max_pages)
+        {
+            return nullptr;
+        }
+
+        // pages kept by reset() are used first
+        if(next_page == m_buffers.size())
+        {
+            add_page();
+        }
 
-        auto buffer = new uint8_t[PAGE_SIZE];
-        m_buffers.push_back(buffer);
-        m_buffer_pos = buffer_size;
+        m_buffer_pos = next_page * PAGE_SIZE;
     }
 
-    auto new_pos = m_buffer_pos;
+    auto page = m_buffer_pos / PAGE_SIZE;
+    auto offset = m_buffer_pos % PAGE_SIZE;
     m_buffer_pos += size;
 
-    auto buffer = m_buffers.size() - 1;
-    auto offset = new_pos - (buffer * PAGE_SIZE);
+    auto header = reinterpret_cast<BlockHeader *>(&m_buffers[page][offset]);
+    header->size_class = size_class;
+    header->state = BLOCK_USED;
 
-    return assign_alloc(buffer, offset, size);
+    // pages are contiguous in the bitmap, like in m_buffer_pos
+    set_block_bit((page * PAGE_SIZE + offset) / sizeof(BlockHeader) + 1, true);
+
+    return header + 1;
 }
 
-void DefaultMemoryManager::free(void *ptr)
+void DefaultMemoryManager::reset()
 {
-    auto idx = reinterpret_cast<intptr_t>(ptr);
-    auto it = m_allocs.find(idx);
+    auto scrub = PagePool::instance().scrub();
 
-    if(it == m_allocs.end())
+    if(scrub != PagePool::Scrub::None)
     {
-        throw std::runtime_error("Memory error!");
+        for(size_t page = 0; page * PAGE_SIZE < m_buffer_pos; ++page)
+        {
+            auto used = std::min(PAGE_SIZE, m_buffer_pos - page * PAGE_SIZE);
+            memset(m_buffers[page], scrub == PagePool::Scrub::Zero ? 0 : 0xde, used);
+        }
     }
-    else
+
+    m_buffer_pos = 0;
+    m_free_lists.fill(nullptr);
+    std::fill(m_block_starts.begin(), m_block_starts.end(), 0);
+}
+
+void *DefaultMemoryManager::malloc(size_t size)
+{
+    if(size > PAGE_SIZE - sizeof(BlockHeader))
     {
-        m_allocs.erase(it);
+        throw std::runtime_error("cannot allocate more than page size");
     }
+
+    auto cls = size_class(size);
+
+    if(auto ptr = pop_free(cls))
+    {
+        return ptr;
+    }
+
+    if(auto ptr = bump_alloc(cls))
+    {
+        return ptr;
+    }
+
+    // no more pages left, fall back to a free block of a larger class
+    for(auto larger = cls + 1; larger < NUM_SIZE_CLASSES; ++larger)
+    {
+        if(auto ptr = pop_free(larger))
+        {
+            return ptr;
+        }
+    }
+
+    throw std::runtime_error("out of memory: program tries to allocate too much heap memory!");
+}
+
+void DefaultMemoryManager::free(void *ptr)
+{
+    // only the starts of blocks that are in use have their bit set
+    auto bit = block_bit(ptr);
+
+    if(bit == SIZE_MAX || (m_block_starts[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+    {
+        throw std::runtime_error("Memory error!");
+    }
+
+    auto header = reinterpret_cast<BlockHeader *>(ptr) - 1;
+    set_block_bit(bit, false);
+
+    header->state = BLOCK_FREE;
+    *reinterpret_cast<void **>(ptr) = m_free_lists[header->size_class];
+    m_free_lists[header->size_class] = ptr;
 }
 
 } // namespace cow
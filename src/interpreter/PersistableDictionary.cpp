@@ -1,169 +1,390 @@
+#include <bitstream.h>
 #include <cowlang/PersistableDictionary.h>
+#include <cowlang/StorageBackend.h>
 #include <iostream>
-ValuePtr PersistableDictionary::get(const std::string &key)
+
+namespace
 {
+
+// type byte of the entries of encoded storages
+enum class EncodedType : uint8_t
+{
+    Deleted,
+    String,
+    Integer,
+    Float,
+    Bool
+};
+
+} // namespace
+
+void StorageState::copy_key(const StorageState &other, const std::string &key)
+{
+    auto it = other.m_elements.find(key);
+    if(it != other.m_elements.end())
+        m_elements[key] = it->second;
+    else
+        m_elements.erase(key);
+}
+
+std::set<std::string> StorageState::keys() const
+{
+    std::set<std::string> keys;
+    for(auto &it : m_elements)
+        keys.insert(it.first);
+
+    return keys;
+}
+
+std::string StorageState::encode() const { return encode(keys()); }
+
+std::string StorageState::encode(const std::set<std::string> &keys) const
+{
+    bitstream stream;
+    stream << ENCODING_VERSION;
+    stream << static_cast<uint32_t>(keys.size());
+
+    for(auto &key : keys)
     {
-        auto it = m_elements_string.find(key);
-        if(it != m_elements_string.end())
-            return wrap_value(new(memory_manager()) StringVal(memory_manager(), it->second));
-    }
-    {
-        auto it = m_elements_int.find(key);
-        if(it != m_elements_int.end())
-            return wrap_value(new(memory_manager()) IntVal(memory_manager(), it->second));
+        stream << key;
+
+        auto it = m_elements.find(key);
+        if(it == m_elements.end())
+        {
+            stream << static_cast<uint8_t>(EncodedType::Deleted);
+            continue;
+        }
+
+        auto &value = it->second;
+        if(auto str = std::get_if<std::string>(&value))
+        {
+            stream << static_cast<uint8_t>(EncodedType::String) << *str;
+        }
+        else if(auto i = std::get_if<int64_t>(&value))
+        {
+            stream << static_cast<uint8_t>(EncodedType::Integer) << *i;
+        }
+        else if(auto d = std::get_if<double>(&value))
+        {
+            stream << static_cast<uint8_t>(EncodedType::Float) << *d;
+        }
+        else
+        {
+            stream << static_cast<uint8_t>(EncodedType::Bool) << std::get<bool>(value);
+        }
     }
+
+    return stream.store();
+}
+
+void StorageState::decode(const std::string &data)
+{
+    bitstream_view view(data);
+
+    uint8_t version = 0;
+    view >> version;
+    if(version != ENCODING_VERSION)
     {
-        auto it = m_elements_double.find(key);
-        if(it != m_elements_double.end())
-            return wrap_value(new(memory_manager()) FloatVal(memory_manager(), it->second));
+        throw std::runtime_error("Unsupported storage format version " + std::to_string(version));
     }
+
+    uint32_t size = 0;
+    view >> size;
+
+    for(uint32_t i = 0; i < size; ++i)
     {
-        auto it = m_elements_bool.find(key);
-        if(it != m_elements_bool.end())
-            return wrap_value(new(memory_manager()) BoolVal(memory_manager(), it->second));
+        std::string key;
+        uint8_t type = 0;
+        view >> key >> type;
+
+        switch(static_cast<EncodedType>(type))
+        {
+        case EncodedType::Deleted:
+            m_elements.erase(key);
+            break;
+        case EncodedType::String:
+        {
+            std::string value;
+            view >> value;
+            m_elements[key] = std::move(value);
+            break;
+        }
+        case EncodedType::Integer:
+        {
+            int64_t value = 0;
+            view >> value;
+            m_elements[key] = value;
+            break;
+        }
+        case EncodedType::Float:
+        {
+            double value = 0;
+            view >> value;
+            m_elements[key] = value;
+            break;
+        }
+        case EncodedType::Bool:
+        {
+            uint8_t value = 0;
+            view >> value;
+            m_elements[key] = value != 0;
+            break;
+        }
+        default:
+            throw std::runtime_error("Invalid type in encoded storage");
+        }
     }
-    return nullptr;
+}
+
+ValuePtr PersistableDictionary::get(const std::string &key)
+{
+    load(key);
+    record_read(key);
+
+    auto it = m_elements.find(key);
+    if(it == m_elements.end())
+        return nullptr;
+
+    auto &value = it->second;
+    if(auto str = std::get_if<std::string>(&value))
+        return wrap_value(new(memory_manager()) StringVal(memory_manager(), *str));
+    if(auto i = std::get_if<int64_t>(&value))
+        return memory_manager().create_integer(*i);
+    if(auto d = std::get_if<double>(&value))
+        return wrap_value(new(memory_manager()) FloatVal(memory_manager(), *d));
+
+    return memory_manager().create_boolean(std::get<bool>(value));
 }
 
 void PersistableDictionary::apply(const std::string &key, ValuePtr value, BinaryOpType op)
 {
+    load(key);
+    record_read(key);
 
     int64_t target = 0;
-    auto itx = m_elements_bool.find(key);
-    auto ity = m_elements_double.find(key);
-    auto itz = m_elements_string.find(key);
-    if(itx != m_elements_bool.end())
-        throw std::runtime_error("Values need to be numerics");
-    if(ity != m_elements_double.end())
-        throw std::runtime_error("Values need to be numerics");
-    if(itz != m_elements_string.end())
-        throw std::runtime_error("Values need to be numerics");
+    auto it = m_elements.find(key);
+    if(it != m_elements.end())
+    {
+        auto i = std::get_if<int64_t>(&it->second);
+        if(!i)
+            throw std::runtime_error("Values need to be numerics");
 
-    auto it = m_elements_int.find(key);
-    if(it != m_elements_int.end())
-        target = it->second;
+        target = *i;
+    }
 
     if(!value || value->type() != ValueType::Integer)
     {
         throw std::runtime_error("Values need to be numerics");
     }
 
+    auto operand = value_cast<IntVal>(value)->get();
+    int64_t result;
+
     switch(op)
     {
     case BinaryOpType::Add:
-    {
-
-        auto i_value = value_cast<IntVal>(value);
-        m_elements_int[key] = i_value->get() + target;
-
+        result = operand + target;
         break;
-    }
     case BinaryOpType::Sub:
-    {
-
-        auto i_value = value_cast<IntVal>(value);
-        m_elements_int[key] = target - i_value->get();
-
+        result = target - operand;
         break;
-    }
     case BinaryOpType::Mult:
-    {
-
-        auto i_value = value_cast<IntVal>(value);
-        m_elements_int[key] = target * i_value->get();
-
+        result = target * operand;
         break;
-    }
     default:
         throw std::runtime_error("Unknown binary op");
     }
+
+    record_write(key);
+
+    if(it != m_elements.end())
+        it->second = result;
+    else
+        m_elements.emplace(key, result);
 }
+
 void PersistableDictionary::insert(const std::string &key, ValuePtr value)
 {
+    StorageValue element;
+
     if(value->type() == ValueType::String)
     {
-        std::string _value = unpack_string(value);
-        remove(key);
-        m_elements_string[key] = _value;
+        element = unpack_string(value);
     }
     else if(value->type() == ValueType::Integer)
     {
-        int64_t _value = unpack_integer(value);
-        remove(key);
-        m_elements_int[key] = _value;
+        element = unpack_integer(value);
     }
     else if(value->type() == ValueType::Bool)
     {
-        bool _value = unpack_bool(value);
-        remove(key);
-        m_elements_bool[key] = _value;
+        element = unpack_bool(value);
     }
     else if(value->type() == ValueType::Float)
     {
-        double _value = unpack_float(value);
-        remove(key);
-        m_elements_double[key] = _value;
+        element = unpack_float(value);
     }
     else
     {
         throw std::runtime_error(
         "Persistent directories can only store string, int, float and boolean.");
     }
+
+    load(key);
+    record_write(key);
+    m_elements.insert_or_assign(key, std::move(element));
 }
 
 void PersistableDictionary::clear()
 {
-    m_elements_string.clear();
-    m_elements_int.clear();
-    m_elements_bool.clear();
-    m_elements_double.clear();
+    if(m_backend)
+    {
+        throw std::runtime_error("Lazily loaded storages cannot be cleared");
+    }
+
+    for(auto &it : m_elements)
+        record_write(it.first);
+
+    m_elements.clear();
 }
 
 void PersistableDictionary::remove(const std::string &key)
 {
+    load(key);
+    record_write(key);
+
+    m_elements.erase(key);
+}
+
+bool PersistableDictionary::has(const std::string &key)
+{
+    load(key);
+    record_read(key);
+
+    return m_elements.count(key) > 0;
+}
+
+void PersistableDictionary::set_backend(std::shared_ptr<StorageBackend> backend)
+{
+    m_backend.reset(new Backend());
+    m_backend->backend = std::move(backend);
+}
+
+void PersistableDictionary::load_from_backend(const std::string &key)
+{
+    // loading is not a change, so it is neither journaled nor tracked
+    if(m_backend->loaded.insert(key).second)
     {
-        auto it = m_elements_string.find(key);
-        if(it != m_elements_string.end())
-            m_elements_string.erase(it);
+        m_backend->backend->load(key, *this);
     }
+}
+
+size_t PersistableDictionary::savepoint()
+{
+    if(!m_journal)
+    {
+        m_journal.reset(new Journal());
+    }
+
+    m_journal->savepoints.push_back(m_journal->changes.size());
+    m_journal->keys.emplace_back();
+    return m_journal->savepoints.size() - 1;
+}
+
+void PersistableDictionary::commit(size_t savepoint)
+{
+    if(!m_journal || savepoint >= m_journal->savepoints.size())
     {
-        auto it = m_elements_int.find(key);
-        if(it != m_elements_int.end())
-            m_elements_int.erase(it);
+        throw std::runtime_error("No such savepoint");
     }
+
+    // the changes now belong to the enclosing savepoint, which keeps the first one of each key
+    if(savepoint > 0)
     {
-        auto it = m_elements_int.find(key);
-        if(it != m_elements_int.end())
-            m_elements_int.erase(it);
+        auto &changes = m_journal->changes;
+        auto &keys = m_journal->keys[savepoint - 1];
+        auto end = m_journal->savepoints[savepoint];
+
+        for(auto i = end; i < changes.size(); ++i)
+        {
+            if(!keys.insert(changes[i].key).second)
+                continue;
+
+            if(i != end)
+                changes[end] = std::move(changes[i]);
+            ++end;
+        }
+
+        changes.resize(end);
     }
+
+    m_journal->savepoints.resize(savepoint);
+    m_journal->keys.resize(savepoint);
+
+    // nothing can be rolled back anymore
+    if(m_journal->savepoints.empty())
     {
-        auto it = m_elements_double.find(key);
-        if(it != m_elements_double.end())
-            m_elements_double.erase(it);
+        m_journal.reset();
     }
 }
 
-bool PersistableDictionary::has(const std::string &key)
+void PersistableDictionary::rollback(size_t savepoint)
 {
+    if(!m_journal || savepoint >= m_journal->savepoints.size())
     {
-        auto it = m_elements_string.find(key);
-        if(it != m_elements_string.end())
-            return true;
+        throw std::runtime_error("No such savepoint");
     }
+
+    auto &changes = m_journal->changes;
+    auto begin = m_journal->savepoints[savepoint];
+
+    while(changes.size() > begin)
     {
-        auto it = m_elements_int.find(key);
-        if(it != m_elements_int.end())
-            return true;
+        auto &change = changes.back();
+        if(change.previous)
+            m_elements[change.key] = std::move(*change.previous);
+        else
+            m_elements.erase(change.key);
+        changes.pop_back();
     }
+
+    m_journal->savepoints.resize(savepoint);
+    m_journal->keys.resize(savepoint);
+
+    if(m_journal->savepoints.empty())
     {
-        auto it = m_elements_int.find(key);
-        if(it != m_elements_int.end())
-            return true;
+        m_journal.reset();
     }
+}
+
+std::set<std::string> PersistableDictionary::changed_keys(size_t savepoint) const
+{
+    if(!m_journal || savepoint >= m_journal->savepoints.size())
     {
-        auto it = m_elements_double.find(key);
-        if(it != m_elements_double.end())
-            return true;
+        throw std::runtime_error("No such savepoint");
     }
-    return false;
+
+    std::set<std::string> keys;
+    auto &changes = m_journal->changes;
+    for(auto i = m_journal->savepoints[savepoint]; i < changes.size(); ++i)
+    {
+        keys.insert(changes[i].key);
+    }
+
+    return keys;
+}
+
+void PersistableDictionary::journal(const std::string &key)
+{
+    // the value before the first change is already recorded
+    if(!m_journal->keys.back().insert(key).second)
+        return;
+
+    Change change;
+    change.key = key;
+
+    auto it = m_elements.find(key);
+    if(it != m_elements.end())
+        change.previous = it->second;
+
+    m_journal->changes.push_back(std::move(change));
 }
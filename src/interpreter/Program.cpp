@@ -0,0 +1,971 @@
+#include <bitstream.h>
+#include <cowlang/Program.h>
+#include <cowlang/Scope.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace cow
+{
+
+namespace
+{
+
+// Bytecode nested deeper than this is rejected instead of overflowing the native stack
+constexpr uint32_t MAX_NESTING = 4096;
+
+const char *ERROR_EOF = "Unexpected EOF";
+const char *ERROR_SKIP = "Failed to skip unknown node type!";
+const char *ERROR_UNKNOWN = "Unknown node type!";
+const char *ERROR_FORMAT = "VM was halted: bytecode is improperly formatted.";
+
+bool is_known(NodeType type)
+{
+    return static_cast<uint32_t>(type) <= static_cast<uint32_t>(NodeType::Global);
+}
+
+bool is_skippable(NodeType type)
+{
+    switch(type)
+    {
+    case NodeType::ListComp:
+    case NodeType::Comprehension:
+    case NodeType::Import:
+    case NodeType::ImportFrom:
+    case NodeType::Alias:
+    case NodeType::FunctionDef:
+    case NodeType::FunctionStartDefaults:
+    case NodeType::FunctionStartStub:
+    case NodeType::FunctionStart:
+    case NodeType::FunctionEnd:
+    case NodeType::Global:
+        return false;
+    default:
+        return is_known(type);
+    }
+}
+
+// Pooled strings are an index into the constant pool, legacy ones are stored inline
+void skip_string(bitstream_view &in, bool pooled)
+{
+    uint32_t length = 0;
+    in >> length;
+    if(!pooled)
+        in.skip(length);
+}
+
+void read_name_raw(bitstream_view &in, bool pooled)
+{
+    NodeType type;
+    in >> type;
+    if(type != NodeType::Name && type != NodeType::String)
+        throw std::runtime_error("Not a valid name");
+
+    skip_string(in, pooled);
+}
+
+void read_names_raw(bitstream_view &in, bool pooled)
+{
+    NodeType type;
+    in >> type;
+    if(type == NodeType::Name || type == NodeType::String)
+    {
+        skip_string(in, pooled);
+    }
+    else if(type == NodeType::Tuple)
+    {
+        uint32_t num_elems = 0;
+        in >> num_elems;
+
+        if(num_elems != 2)
+            throw std::runtime_error("Can only name pairs");
+
+        read_name_raw(in, pooled);
+        read_name_raw(in, pooled);
+    }
+    else
+    {
+        throw std::runtime_error("Not a valid name [" + std::to_string((int)type) + "]");
+    }
+}
+
+/**
+ * Skips a node on the raw bytecode and counts the steps this costs
+ *
+ * The filters of a list comprehension are skipped without ever being read as nodes (their
+ * count gets mistaken for a node type), so this is the only way to charge them faithfully.
+ */
+void skip_raw(bitstream_view &in, bool pooled, uint32_t &steps, uint32_t depth)
+{
+    if(depth > MAX_NESTING)
+        throw std::runtime_error(ERROR_FORMAT);
+
+    NodeType type;
+    in >> type;
+
+    uint32_t size = 0;
+    uint32_t op = 0;
+
+    switch(type)
+    {
+    case NodeType::Pass:
+    case NodeType::Break:
+    case NodeType::Continue:
+        break;
+    case NodeType::Name:
+    case NodeType::String:
+        skip_string(in, pooled);
+        break;
+    case NodeType::Integer:
+        in >> op;
+        break;
+    case NodeType::ForLoop:
+        read_names_raw(in, pooled);
+        skip_raw(in, pooled, steps, depth + 1);
+        skip_raw(in, pooled, steps, depth + 1);
+        break;
+    case NodeType::Assign:
+    case NodeType::Call:
+        skip_raw(in, pooled, steps, depth + 1);
+        in >> size;
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            steps += 1;
+            skip_raw(in, pooled, steps, depth + 1);
+        }
+        break;
+    case NodeType::Compare:
+        skip_raw(in, pooled, steps, depth + 1);
+        in >> size;
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            steps += 1;
+            in >> op;
+            skip_raw(in, pooled, steps, depth + 1);
+        }
+        break;
+    case NodeType::StatementList:
+    case NodeType::List:
+    case NodeType::Tuple:
+        in >> size;
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            steps += 1;
+            skip_raw(in, pooled, steps, depth + 1);
+        }
+        break;
+    case NodeType::BoolOp:
+        in >> op >> size;
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            steps += 1;
+            skip_raw(in, pooled, steps, depth + 1);
+        }
+        break;
+    case NodeType::Dictionary:
+        in >> size;
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            steps += 1;
+            skip_raw(in, pooled, steps, depth + 1);
+            skip_raw(in, pooled, steps, depth + 1);
+        }
+        break;
+    case NodeType::Index:
+    case NodeType::Return:
+        skip_raw(in, pooled, steps, depth + 1);
+        break;
+    case NodeType::UnaryOp:
+        in >> op;
+        skip_raw(in, pooled, steps, depth + 1);
+        break;
+    case NodeType::BinaryOp:
+    case NodeType::AugmentedAssign:
+        in >> op;
+        skip_raw(in, pooled, steps, depth + 1);
+        skip_raw(in, pooled, steps, depth + 1);
+        break;
+    case NodeType::If:
+    case NodeType::Attribute:
+    case NodeType::Subscript:
+    case NodeType::WhileLoop:
+        skip_raw(in, pooled, steps, depth + 1);
+        skip_raw(in, pooled, steps, depth + 1);
+        break;
+    case NodeType::IfElse:
+        skip_raw(in, pooled, steps, depth + 1);
+        skip_raw(in, pooled, steps, depth + 1);
+        skip_raw(in, pooled, steps, depth + 1);
+        break;
+    default:
+        throw std::runtime_error(ERROR_SKIP);
+    }
+}
+
+} // namespace
+
+/**
+ * Turns bytecode into the flat instruction array of a Program
+ */
+class ProgramDecoder
+{
+public:
+    ProgramDecoder(Program &program) : m_program(program) {}
+
+    /**
+     * Decodes a whole program, with or without the constant pool header
+     */
+    void decode(bitstream_view in)
+    {
+        // the top level frame has a slot for every string
+        m_program.m_frames.emplace_back();
+        m_frames.emplace_back(0);
+
+        decode_program(in);
+        close_frame();
+        collect_functions();
+    }
+
+private:
+    /**
+     * Collects the names used by the code of a function while it's being decoded
+     */
+    struct FrameBuilder
+    {
+        FrameBuilder(uint32_t frame_) : frame(frame_) {}
+
+        uint32_t frame;
+        std::vector<uint32_t> nodes; // Name and String nodes that are part of the code
+        std::vector<uint32_t> names;
+    };
+
+    void decode_program(bitstream_view in)
+    {
+        bitstream_view header(in);
+        uint32_t magic = 0;
+
+        if(header.remaining() >= sizeof(magic))
+            header >> magic;
+
+        if(magic != BYTECODE_MAGIC)
+        {
+            decode_region(in);
+            return;
+        }
+
+        try
+        {
+            uint32_t version = 0;
+            header >> version;
+            if(version != BYTECODE_VERSION)
+                throw std::runtime_error("Unsupported bytecode version: " + std::to_string(version));
+
+            uint32_t num_strings = 0;
+            header >> num_strings;
+            for(uint32_t i = 0; i < num_strings; ++i)
+            {
+                std::string str;
+                header >> str;
+                m_pool.push_back(intern(str));
+            }
+        }
+        catch(std::runtime_error &e)
+        {
+            fail(push(), Fault::Truncated, e.what());
+            return;
+        }
+
+        m_pooled = true;
+        decode_region(header.view(header.remaining()));
+    }
+
+    // Resolves the parameters of every function, once all strings are known
+    void collect_functions()
+    {
+        m_program.m_functions.resize(m_program.m_frames.size());
+
+        for(uint32_t idx = 0; idx < size(); ++idx)
+        {
+            auto &def = at(idx);
+            if(def.type != NodeType::FunctionDef || def.fault != Fault::None || def.frame == 0)
+                continue;
+
+            auto &function = m_program.m_functions[def.frame];
+            function.entry = def.operand;
+            function.frame = def.frame;
+
+            uint32_t arg = at(idx + 1).end;
+            for(uint32_t i = 0; i < def.size && arg < size(); ++i, arg = at(arg).end)
+            {
+                auto &node = at(arg);
+
+                // such a function fails before it is defined, when its arguments are read
+                if((node.type != NodeType::Name && node.type != NodeType::String) ||
+                   node.fault != Fault::None)
+                {
+                    break;
+                }
+
+                function.params.push_back(m_program.symbol(def.frame, m_program.m_strings[node.name]));
+            }
+        }
+    }
+
+    // Sorts the names of the innermost frame into slots and resolves its nodes to them
+    void close_frame()
+    {
+        auto builder = std::move(m_frames.back());
+        m_frames.pop_back();
+
+        auto &names = builder.names;
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+
+        if(builder.frame != 0)
+            m_program.m_frames[builder.frame] = std::move(names);
+
+        for(auto idx : builder.nodes)
+        {
+            auto &node = at(idx);
+            node.frame = builder.frame;
+            node.slot = m_program.slot(builder.frame, node.name);
+        }
+    }
+
+    /**
+     * Decodes nodes until the whole view has been consumed
+     *
+     * The region is always terminated by a truncated node, so that reading past its end raises
+     * the same error the raw stream did.
+     *
+     * @return the index of the first node of the region
+     */
+    uint32_t decode_region(bitstream_view in, uint32_t depth = 0)
+    {
+        auto first = size();
+
+        while(in.remaining() > 0)
+        {
+            if(!decode_node(in, depth))
+                break;
+        }
+
+        auto idx = push();
+        fail(idx, Fault::Truncated, ERROR_EOF);
+        return first;
+    }
+
+    uint32_t size() const { return m_program.m_code.size(); }
+
+    Instruction &at(uint32_t idx) { return m_program.m_code[idx]; }
+
+    uint32_t push()
+    {
+        m_program.m_code.emplace_back();
+        return size() - 1;
+    }
+
+    uint32_t intern(const std::string &str)
+    {
+        auto it = m_program.m_ids.find(str);
+        if(it != m_program.m_ids.end())
+            return it->second;
+
+        uint32_t id = m_program.m_strings.size();
+        m_program.m_strings.push_back(str);
+        m_program.m_builtins.push_back(Scope::builtin_name(str));
+        m_program.m_ids.emplace(str, id);
+        return id;
+    }
+
+    bool fail(uint32_t idx, Fault fault, const std::string &error, int32_t stage = 0)
+    {
+        auto &node = at(idx);
+        node.fault = fault;
+        node.error = intern(error);
+        node.integer = stage;
+        finish(idx);
+        return false;
+    }
+
+    bool decode_children(bitstream_view &in, uint32_t count, uint32_t depth)
+    {
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            if(!decode_node(in, depth + 1))
+                return false;
+        }
+        return true;
+    }
+
+    uint32_t read_string(bitstream_view &in)
+    {
+        if(m_pooled)
+        {
+            uint32_t index = 0;
+            in >> index;
+            if(index >= m_pool.size())
+                throw std::runtime_error("Invalid constant index: " + std::to_string(index));
+            return m_pool[index];
+        }
+
+        std::string str;
+        in >> str;
+        return intern(str);
+    }
+
+    bool decode_node(bitstream_view &in, uint32_t depth);
+    bool decode_function(bitstream_view &in, uint32_t idx, uint32_t depth);
+    bool decode_operands(bitstream_view &in, uint32_t idx, uint32_t depth);
+    bool decode_comprehension(bitstream_view &in, uint32_t idx, uint32_t depth);
+
+    void finish(uint32_t idx);
+
+    Program &m_program;
+    std::vector<FrameBuilder> m_frames;
+
+    // interned strings of the constant pool
+    std::vector<uint32_t> m_pool;
+    bool m_pooled = false;
+};
+
+bool ProgramDecoder::decode_node(bitstream_view &in, uint32_t depth)
+{
+    auto idx = push();
+
+    NodeType type;
+    try
+    {
+        in >> type;
+    }
+    catch(std::runtime_error &e)
+    {
+        return fail(idx, Fault::Truncated, e.what());
+    }
+
+    at(idx).type = type;
+
+    if(depth > MAX_NESTING)
+        return fail(idx, Fault::Malformed, ERROR_FORMAT);
+
+    if(!is_known(type) || type == NodeType::FunctionStartDefaults ||
+       type == NodeType::FunctionStartStub || type == NodeType::FunctionStart ||
+       type == NodeType::FunctionEnd)
+    {
+        return fail(idx, Fault::UnknownType, ERROR_UNKNOWN);
+    }
+
+    bool ok = true;
+    uint32_t size = 0;
+    uint32_t op = 0;
+
+    try
+    {
+        switch(type)
+        {
+        case NodeType::Pass:
+        case NodeType::Break:
+        case NodeType::Continue:
+            break;
+        case NodeType::Name:
+        case NodeType::String:
+            at(idx).name = read_string(in);
+            m_frames.back().nodes.push_back(idx);
+            if(type == NodeType::Name)
+                m_frames.back().names.push_back(at(idx).name);
+            break;
+        case NodeType::Integer:
+            in >> at(idx).integer;
+            break;
+        case NodeType::Alias:
+            at(idx).name = read_string(in);
+            at(idx).as_name = read_string(in);
+            break;
+        case NodeType::StatementList:
+        case NodeType::List:
+        case NodeType::Tuple:
+        case NodeType::Global:
+            in >> size;
+            at(idx).size = size;
+            ok = decode_children(in, size, depth);
+            break;
+        case NodeType::Dictionary:
+            in >> size;
+            at(idx).size = size;
+            for(uint32_t i = 0; i < size && ok; ++i)
+                ok = decode_children(in, 2, depth);
+            break;
+        case NodeType::BoolOp:
+            in >> op >> size;
+            at(idx).op = op;
+            at(idx).size = size;
+            ok = decode_children(in, size, depth);
+            break;
+        case NodeType::UnaryOp:
+            in >> op;
+            at(idx).op = op;
+            ok = decode_children(in, 1, depth);
+            break;
+        case NodeType::BinaryOp:
+        case NodeType::AugmentedAssign:
+            in >> op;
+            at(idx).op = op;
+            ok = decode_children(in, 2, depth);
+            break;
+        case NodeType::Index:
+        case NodeType::Return:
+        case NodeType::Import:
+            ok = decode_children(in, 1, depth);
+            break;
+        case NodeType::If:
+        case NodeType::Attribute:
+        case NodeType::Subscript:
+        case NodeType::WhileLoop:
+        case NodeType::ImportFrom:
+            ok = decode_children(in, 2, depth);
+            break;
+        case NodeType::IfElse:
+        case NodeType::ForLoop:
+            ok = decode_children(in, 3, depth);
+            break;
+        case NodeType::Assign:
+        case NodeType::Call:
+        case NodeType::ListComp:
+        case NodeType::Compare:
+            // the number of items follows the first operand
+            if(!decode_children(in, 1, depth))
+            {
+                ok = false;
+                break;
+            }
+            ok = decode_operands(in, idx, depth);
+            break;
+        case NodeType::Comprehension:
+            ok = decode_comprehension(in, idx, depth);
+            break;
+        case NodeType::FunctionDef:
+            ok = decode_function(in, idx, depth);
+            break;
+        default:
+            return fail(idx, Fault::UnknownType, ERROR_UNKNOWN);
+        }
+    }
+    catch(std::runtime_error &e)
+    {
+        return fail(idx, Fault::Malformed, e.what());
+    }
+
+    finish(idx);
+    return ok && at(idx).fault == Fault::None;
+}
+
+bool ProgramDecoder::decode_operands(bitstream_view &in, uint32_t idx, uint32_t depth)
+{
+    uint32_t size = 0;
+    try
+    {
+        in >> size;
+    }
+    catch(std::runtime_error &e)
+    {
+        return fail(idx, Fault::Late, e.what());
+    }
+
+    at(idx).size = size;
+    if(at(idx).type != NodeType::Compare)
+        return decode_children(in, size, depth);
+
+    at(idx).operand = m_program.m_compare_ops.size();
+    for(uint32_t i = 0; i < size; ++i)
+    {
+        CompareOpType op_type;
+        try
+        {
+            in >> op_type;
+        }
+        catch(std::runtime_error &e)
+        {
+            return fail(idx, Fault::Late, e.what());
+        }
+
+        m_program.m_compare_ops.push_back(op_type);
+        if(!decode_children(in, 1, depth))
+            return false;
+    }
+    return true;
+}
+
+bool ProgramDecoder::decode_comprehension(bitstream_view &in, uint32_t idx, uint32_t depth)
+{
+    // target and iterator
+    if(!decode_children(in, 2, depth))
+        return false;
+
+    // The interpreter skips the filters without reading their count, so the count is taken for
+    // a node type. Replay that on the raw bytes and remember what it costs.
+    auto filters = push();
+    auto &node = at(filters);
+    node.fault = Fault::Opaque;
+
+    uint32_t filters_end = 0;
+    uint32_t steps = 0;
+    bitstream_view raw(in);
+
+    try
+    {
+        skip_raw(raw, m_pooled, steps, depth + 1);
+        filters_end = raw.pos();
+    }
+    catch(std::runtime_error &e)
+    {
+        node.skip_error = intern(e.what());
+    }
+    node.skip_cost = steps;
+
+    uint32_t num_ifs = 0;
+    try
+    {
+        in >> num_ifs;
+    }
+    catch(std::runtime_error &e)
+    {
+        at(filters).end = size();
+        return fail(idx, Fault::Late, e.what());
+    }
+
+    at(idx).size = num_ifs;
+    bool complete = decode_children(in, num_ifs, depth);
+
+    // skipping only lands on a node boundary if there were no filters at all
+    at(filters).end = size();
+    if(at(filters).skip_error == Instruction::NO_ERROR && (!complete || filters_end != in.pos()))
+        at(filters).skip_error = intern(ERROR_FORMAT);
+
+    return complete;
+}
+
+bool ProgramDecoder::decode_function(bitstream_view &in, uint32_t idx, uint32_t depth)
+{
+    // name
+    if(!decode_children(in, 1, depth))
+        return false;
+
+    uint32_t stub_len = 0;
+    uint32_t num_args = 0;
+    NodeType type;
+
+    try
+    {
+        in >> stub_len >> type;
+        if(type != NodeType::FunctionStart)
+            return fail(idx, Fault::Stub, "Are you kidding me, you stupid script kiddy? [coder is insane]", 0);
+        in >> num_args;
+    }
+    catch(std::runtime_error &e)
+    {
+        return fail(idx, Fault::Stub, e.what(), 0);
+    }
+
+    at(idx).size = num_args;
+    if(!decode_children(in, num_args, depth))
+        return false;
+
+    // the arguments get a slot in the frame of the body
+    std::vector<uint32_t> args;
+    for(uint32_t i = 0, arg = at(idx + 1).end; i < num_args; ++i, arg = at(arg).end)
+    {
+        if(at(arg).type == NodeType::Name)
+            args.push_back(at(arg).name);
+    }
+
+    try
+    {
+        uint32_t num_defaults = 0;
+        in >> type;
+        if(type == NodeType::FunctionStartDefaults)
+            in >> num_defaults;
+        if(type != NodeType::FunctionStartDefaults || num_defaults != num_args)
+            return fail(idx, Fault::Stub, "Stop hacking the bytecode, you pathetic little worm!", 1);
+    }
+    catch(std::runtime_error &e)
+    {
+        return fail(idx, Fault::Stub, e.what(), 1);
+    }
+
+    if(!decode_children(in, num_args, depth))
+        return false;
+
+    try
+    {
+        in >> type;
+        if(type != NodeType::FunctionStartStub)
+            return fail(idx, Fault::Stub, "Stop hacking the bytecode, you pathetic little worm!", 2);
+
+        auto body = in.view(stub_len);
+
+        uint32_t frame = m_program.m_frames.size();
+        m_program.m_frames.emplace_back();
+        m_frames.emplace_back(frame);
+        m_frames.back().names = std::move(args);
+
+        at(idx).frame = frame;
+        at(idx).operand = decode_region(body, depth + 1);
+        close_frame();
+
+        in >> type;
+        if(type != NodeType::FunctionEnd)
+            return fail(idx, Fault::Stub, "Are you kidding me, you stupid script kiddy? [wrong type order]", 2);
+    }
+    catch(std::runtime_error &e)
+    {
+        return fail(idx, Fault::Stub, e.what(), 2);
+    }
+
+    return true;
+}
+
+void ProgramDecoder::finish(uint32_t idx)
+{
+    auto &node = at(idx);
+    node.end = size();
+
+    if(node.fault == Fault::Opaque)
+        return;
+
+    if(node.fault == Fault::Truncated)
+    {
+        node.skip_error = node.error;
+        return;
+    }
+
+    if(!is_skippable(node.type) || node.fault == Fault::UnknownType || node.fault == Fault::Stub)
+    {
+        node.skip_error = intern(ERROR_SKIP);
+        return;
+    }
+
+    // Walk the children the way skipping them charges steps: containers charge one step per
+    // item, the leading operand of assignments, calls and comparisons is free.
+    uint32_t charged_from = 0;
+    uint32_t per_item = 1;
+    uint32_t first = 0;
+
+    switch(node.type)
+    {
+    case NodeType::StatementList:
+    case NodeType::List:
+    case NodeType::Tuple:
+    case NodeType::BoolOp:
+        break;
+    case NodeType::Dictionary:
+        per_item = 2;
+        break;
+    case NodeType::Assign:
+    case NodeType::Call:
+    case NodeType::Compare:
+        charged_from = 1;
+        break;
+    case NodeType::ForLoop:
+    {
+        // the target is read as names, not skipped
+        uint32_t pc = idx + 1;
+        Symbol names[2];
+        try
+        {
+            m_program.read_symbols(pc, names);
+        }
+        catch(std::runtime_error &e)
+        {
+            node.skip_error = intern(e.what());
+            return;
+        }
+        first = 1;
+        charged_from = std::numeric_limits<uint32_t>::max();
+        break;
+    }
+    default:
+        charged_from = std::numeric_limits<uint32_t>::max();
+        break;
+    }
+
+    uint32_t cost = 0;
+    uint32_t child = idx + 1;
+    for(uint32_t i = 0; child < node.end; ++i)
+    {
+        if(i >= first)
+        {
+            if(i >= charged_from && (i - charged_from) % per_item == 0)
+                cost += 1;
+
+            auto &c = at(child);
+            cost += c.skip_cost;
+            if(c.skip_error != Instruction::NO_ERROR)
+            {
+                node.skip_cost = cost;
+                node.skip_error = c.skip_error;
+                return;
+            }
+        }
+        child = at(child).end;
+    }
+
+    node.skip_cost = cost;
+    if(node.fault != Fault::None)
+        node.skip_error = node.error;
+}
+
+Program::Program(bitstream_view data)
+{
+    ProgramDecoder decoder(*this);
+    decoder.decode(data);
+}
+
+size_t Program::memory_usage() const
+{
+    size_t usage = sizeof(*this) + m_code.capacity() * sizeof(Instruction) +
+                   m_builtins.capacity() * sizeof(BuiltinName) +
+                   m_compare_ops.capacity() * sizeof(CompareOpType);
+
+    // every string is referenced by m_strings and by m_ids
+    for(auto &str : m_strings)
+    {
+        usage += 2 * (sizeof(std::string) + str.capacity()) + sizeof(uint32_t) + sizeof(void *);
+    }
+
+    for(auto &frame : m_frames)
+    {
+        usage += sizeof(frame) + frame.capacity() * sizeof(uint32_t);
+    }
+
+    for(auto &function : m_functions)
+    {
+        usage += sizeof(function) + function.params.capacity() * sizeof(Symbol);
+    }
+
+    return usage;
+}
+
+uint32_t Program::find(const std::string &str) const
+{
+    auto it = m_ids.find(str);
+    if(it == m_ids.end())
+        return NO_SLOT;
+
+    return it->second;
+}
+
+uint32_t Program::frame_size(uint32_t frame) const
+{
+    if(frame == 0)
+        return m_strings.size();
+
+    return m_frames[frame].size();
+}
+
+uint32_t Program::slot(uint32_t frame, uint32_t id) const
+{
+    if(frame == 0)
+        return id < m_strings.size() ? id : NO_SLOT;
+
+    auto &names = m_frames[frame];
+    auto it = std::lower_bound(names.begin(), names.end(), id);
+    if(it == names.end() || *it != id)
+        return NO_SLOT;
+
+    return it - names.begin();
+}
+
+Symbol Program::symbol(const Instruction &node) const
+{
+    Symbol symbol(m_strings[node.name]);
+    symbol.program = this;
+    symbol.id = node.name;
+    symbol.frame = node.frame;
+    symbol.slot = node.slot;
+    symbol.builtin = m_builtins[node.name];
+    return symbol;
+}
+
+Symbol Program::symbol(uint32_t frame, const std::string &str) const
+{
+    auto id = find(str);
+    if(id == NO_SLOT)
+        return Symbol(str);
+
+    Symbol symbol(m_strings[id]);
+    symbol.program = this;
+    symbol.id = id;
+    symbol.frame = frame;
+    symbol.slot = slot(frame, id);
+    symbol.builtin = m_builtins[id];
+    return symbol;
+}
+
+const Instruction &Program::name_node(uint32_t pc) const
+{
+    if(pc >= m_code.size())
+        throw std::runtime_error(ERROR_EOF);
+
+    auto &node = m_code[pc];
+    if(node.fault == Fault::Truncated)
+        throw std::runtime_error(m_strings[node.error]);
+
+    if(node.type != NodeType::Name && node.type != NodeType::String)
+        throw std::runtime_error("Not a valid name");
+
+    if(node.fault != Fault::None)
+        throw std::runtime_error(m_strings[node.error]);
+
+    return node;
+}
+
+const std::string &Program::read_name(uint32_t &pc) const
+{
+    auto &node = name_node(pc);
+    pc = node.end;
+    return m_strings[node.name];
+}
+
+Symbol Program::read_symbol(uint32_t &pc) const
+{
+    auto &node = name_node(pc);
+    pc = node.end;
+    return symbol(node);
+}
+
+uint32_t Program::read_symbols(uint32_t &pc, Symbol symbols[2]) const
+{
+    if(pc >= m_code.size())
+        throw std::runtime_error(ERROR_EOF);
+
+    auto &node = m_code[pc];
+    if(node.fault == Fault::Truncated)
+        throw std::runtime_error(m_strings[node.error]);
+
+    if(node.type == NodeType::Name || node.type == NodeType::String)
+    {
+        symbols[0] = read_symbol(pc);
+        return 1;
+    }
+    else if(node.type == NodeType::Tuple && node.fault == Fault::None)
+    {
+        if(node.size != 2)
+            throw std::runtime_error("Can only name pairs");
+
+        pc += 1;
+        symbols[0] = read_symbol(pc);
+        symbols[1] = read_symbol(pc);
+        return 2;
+    }
+    else if(node.type == NodeType::Tuple)
+    {
+        throw std::runtime_error(m_strings[node.error]);
+    }
+    else
+    {
+        throw std::runtime_error("Not a valid name [" + std::to_string((int)node.type) + "]");
+    }
+}
+
+} // namespace cow
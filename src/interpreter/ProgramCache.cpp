@@ -0,0 +1,141 @@
+#include <bitstream.h>
+#include <cowlang/ProgramCache.h>
+#include <sha2.h>
+#include <snappy.h>
+
+namespace cow
+{
+
+ProgramCache &ProgramCache::instance()
+{
+    // intentionally leaked, like the page pool
+    static auto *cache = new ProgramCache();
+    return *cache;
+}
+
+ProgramCache::Key ProgramCache::hash(const std::string &compressed)
+{
+    Key key;
+    sha256_Raw(reinterpret_cast<const uint8_t *>(compressed.data()), compressed.size(), key.data());
+    return key;
+}
+
+ProgramPtr ProgramCache::get(const std::string &compressed)
+{
+    SnapshotPtr snapshot;
+    return get(hash(compressed), compressed, snapshot);
+}
+
+ProgramPtr ProgramCache::get(const Key &key, const std::string &compressed, SnapshotPtr &snapshot)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_index.find(key);
+        if(it != m_index.end())
+        {
+            m_hits += 1;
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            snapshot = it->second->snapshot;
+            return it->second->program;
+        }
+
+        m_misses += 1;
+    }
+
+    snapshot = nullptr;
+
+    // decode without holding the lock, other contracts can still be looked up meanwhile
+    std::string decompressed;
+    if(!snappy::Uncompress(compressed.data(), compressed.size(), &decompressed))
+    {
+        // the same error as bytecode that ends early, and nothing is cached
+        throw std::runtime_error("Unexpected EOF");
+    }
+
+    ProgramPtr program = std::make_shared<Program>(bitstream_view(decompressed));
+    size_t cost = program->memory_usage();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(cost > m_budget || m_index.find(key) != m_index.end())
+    {
+        // too large to be cached, or another thread was faster
+        return program;
+    }
+
+    evict(m_budget - cost);
+    m_entries.push_front(Entry{ key, program, nullptr, cost });
+    m_index.emplace(key, m_entries.begin());
+    m_usage += cost;
+
+    return program;
+}
+
+void ProgramCache::set_snapshot(const Key &key, SnapshotPtr snapshot)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(key);
+    if(it == m_index.end() || it->second->snapshot || snapshot->program() != it->second->program)
+    {
+        // evicted meanwhile, or the snapshot is of a program that wasn't cached
+        return;
+    }
+
+    auto cost = snapshot->memory_usage();
+    it->second->snapshot = std::move(snapshot);
+    it->second->cost += cost;
+    m_usage += cost;
+    evict(m_budget);
+}
+
+void ProgramCache::evict(size_t budget)
+{
+    while(m_usage > budget)
+    {
+        auto &entry = m_entries.back();
+        m_usage -= entry.cost;
+        m_index.erase(entry.key);
+        m_entries.pop_back();
+    }
+}
+
+void ProgramCache::set_budget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = budget;
+    evict(budget);
+}
+
+void ProgramCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    evict(0);
+}
+
+size_t ProgramCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+size_t ProgramCache::memory_usage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_usage;
+}
+
+uint64_t ProgramCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+uint64_t ProgramCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+} // namespace cow
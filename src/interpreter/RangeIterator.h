@@ -24,7 +24,7 @@ public:
         if(m_pos >= m_end)
             throw stop_iteration_exception();
 
-        auto res = wrap_value(new(memory_manager()) IntVal(memory_manager(), m_pos));
+        auto res = memory_manager().create_integer(m_pos);
         m_pos += m_step_size;
 
         return res;
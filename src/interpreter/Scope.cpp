@@ -7,97 +7,262 @@
 namespace cow
 {
 
-void Scope::set_global_tag(const std::string &name) { m_global_tags.insert(name); }
-
-void Scope::set_value(const std::string &name, ValuePtr value)
+uint32_t Scope::locate(const Symbol &symbol) const
 {
-    if(!m_require_global && m_parent && m_parent->has_value(name))
+    if(!m_program)
     {
-        m_parent->set_value(name, value);
-        return;
+        return NO_SLOT;
     }
-    if(m_require_global && m_global_tags.find(name) != m_global_tags.end() && m_parent)
+
+    if(symbol.program == m_program.get())
     {
-        m_parent->set_value(name, value);
-        return;
+        if(symbol.frame == m_frame)
+        {
+            return symbol.slot;
+        }
+
+        return m_program->slot(m_frame, symbol.id);
+    }
+
+    // resolved by another program or not at all
+    return m_program->slot(m_frame, m_program->find(symbol.str()));
+}
+
+const ValuePtr *Scope::find(const Symbol &symbol) const
+{
+    auto index = locate(symbol);
+
+    if(index == NO_SLOT)
+    {
+        auto it = m_values.find(symbol.str());
+        return it == m_values.end() ? nullptr : &it->second;
     }
 
-    // FIXME actually update references...
-    auto it = m_values.find(name);
-    if(it != m_values.end())
+    if(index >= m_slots.size() || !m_slots[index].assigned)
     {
-        m_values.erase(it);
+        return nullptr;
     }
 
-    m_values.emplace(name, std::move(value));
+    return &m_slots[index].value;
 }
 
-bool Scope::has_value(const std::string &name) const
+Scope::Slot &Scope::slot(uint32_t index)
 {
-    if(m_parent && m_parent->has_value(name))
+    if(m_slots.empty())
     {
-        return true;
+        m_slots.resize(m_program->frame_size(m_frame));
     }
 
-    return m_values.find(name) != m_values.end();
+    return m_slots[index];
 }
 
-ValuePtr Scope::get_value(const std::string &name)
+void Scope::set_global_tag(const Symbol &symbol)
 {
-    Value *val = nullptr;
+    auto index = locate(symbol);
 
-    if(name == BUILTIN_STR_NONE)
+    if(index == NO_SLOT)
     {
-        return std::shared_ptr<Value>{ nullptr };
+        m_global_tags.insert(symbol.str());
     }
-
-    if(name == BUILTIN_STR_RANGE)
+    else
     {
-        val = new(memory_manager()) Builtin(memory_manager(), BuiltinType::Range);
+        slot(index).global = true;
     }
-    else if(name == BUILTIN_STR_MAKE_INT)
+}
+
+void Scope::set_value(const Symbol &symbol, ValuePtr value)
+{
+    // names declared global are set in the parent, all others where the walk stops, so the owner
+    // is found by looking at each scope once
+    for(auto scope = this;; scope = scope->m_parent)
     {
-        val = new(memory_manager()) Builtin(memory_manager(), BuiltinType::MakeInt);
+        auto index = scope->locate(symbol);
+
+        if(index == NO_SLOT)
+        {
+            auto &tags = scope->m_global_tags;
+            if(scope->m_parent && tags.find(symbol.str()) != tags.end())
+            {
+                continue;
+            }
+
+            // FIXME actually update references...
+            scope->m_values[symbol.str()] = std::move(value);
+            return;
+        }
+
+        auto &s = scope->slot(index);
+        if(scope->m_parent && s.global)
+        {
+            continue;
+        }
+
+        s.value = std::move(value);
+        s.assigned = true;
+        return;
     }
-    else if(name == BUILTIN_STR_MAKE_STR)
+}
+
+bool Scope::has_value(const Symbol &symbol) const
+{
+    for(auto scope = this; scope; scope = scope->m_parent)
     {
-        val = new(memory_manager()) Builtin(memory_manager(), BuiltinType::MakeString);
+        if(scope->find(symbol))
+        {
+            return true;
+        }
     }
-    else if(name == BUILTIN_STR_PRINT)
+
+    return false;
+}
+
+void Scope::update_value(const Symbol &symbol, ValuePtr value)
+{
+    for(auto scope = this; scope; scope = scope->m_parent)
     {
-        val = new(memory_manager()) Builtin(memory_manager(), BuiltinType::Print);
+        if(auto current = scope->find(symbol))
+        {
+            *current = std::move(value);
+            return;
+        }
     }
-    else if(name == BUILTIN_STR_LENGTH)
+
+    throw std::runtime_error("No such value: " + symbol.str());
+}
+
+BuiltinName Scope::builtin_name(const std::string &name)
+{
+    static const std::unordered_map<std::string, BuiltinName> names = {
+        { BUILTIN_STR_NONE, BuiltinName::None },
+        { BUILTIN_STR_TRUE, BuiltinName::True },
+        { BUILTIN_STR_FALSE, BuiltinName::False },
+        { BUILTIN_STR_RANGE, BuiltinName::Range },
+        { BUILTIN_STR_MAKE_INT, BuiltinName::MakeInt },
+        { BUILTIN_STR_MAKE_STR, BuiltinName::MakeString },
+        { BUILTIN_STR_PRINT, BuiltinName::Print },
+        { BUILTIN_STR_LENGTH, BuiltinName::Length },
+        { BUILTIN_STR_MIN, BuiltinName::Min },
+        { BUILTIN_STR_MAX, BuiltinName::Max },
+        { BUILTIN_STR_SUM, BuiltinName::Sum },
+        { BUILTIN_STR_SORTED, BuiltinName::Sorted },
+        { BUILTIN_STR_ANY, BuiltinName::Any },
+        { BUILTIN_STR_ALL, BuiltinName::All },
+        { BUILTIN_STR_ENUMERATE, BuiltinName::Enumerate },
+        { BUILTIN_STR_ZIP, BuiltinName::Zip },
+        { BUILTIN_STR_ABS, BuiltinName::Abs },
+    };
+
+    auto it = names.find(name);
+    return it == names.end() ? BuiltinName::NotBuiltin : it->second;
+}
+
+ValuePtr Scope::get_builtin(BuiltinName name)
+{
+    auto &builtins = m_root->m_builtins;
+    if(!builtins)
     {
-        val = new(memory_manager()) Builtin(memory_manager(), BuiltinType::Length);
+        builtins.reset(new std::array<ValuePtr, NUM_BUILTINS>());
     }
-    else if(name == BUILTIN_STR_MIN)
+
+    auto &value = (*builtins)[static_cast<size_t>(name)];
+    if(value)
     {
-        val = new(memory_manager()) Builtin(memory_manager(), BuiltinType::Min);
+        return value;
     }
-    else if(name == BUILTIN_STR_MAX)
+
+    BuiltinType type;
+    switch(name)
     {
-        val = new(memory_manager()) Builtin(memory_manager(), BuiltinType::Max);
+    case BuiltinName::Range:
+        type = BuiltinType::Range;
+        break;
+    case BuiltinName::MakeInt:
+        type = BuiltinType::MakeInt;
+        break;
+    case BuiltinName::MakeString:
+        type = BuiltinType::MakeString;
+        break;
+    case BuiltinName::Print:
+        type = BuiltinType::Print;
+        break;
+    case BuiltinName::Length:
+        type = BuiltinType::Length;
+        break;
+    case BuiltinName::Min:
+        type = BuiltinType::Min;
+        break;
+    case BuiltinName::Max:
+        type = BuiltinType::Max;
+        break;
+    case BuiltinName::Sum:
+        type = BuiltinType::Sum;
+        break;
+    case BuiltinName::Sorted:
+        type = BuiltinType::Sorted;
+        break;
+    case BuiltinName::Any:
+        type = BuiltinType::Any;
+        break;
+    case BuiltinName::All:
+        type = BuiltinType::All;
+        break;
+    case BuiltinName::Enumerate:
+        type = BuiltinType::Enumerate;
+        break;
+    case BuiltinName::Zip:
+        type = BuiltinType::Zip;
+        break;
+    case BuiltinName::Abs:
+        type = BuiltinType::Abs;
+        break;
+    default:
+        throw std::runtime_error("Not a builtin");
     }
 
+    value = ValuePtr(new(m_root->memory_manager()) Builtin(m_root->memory_manager(), type));
+    return value;
+}
+
+ValuePtr Scope::get_value(const Symbol &symbol)
+{
+    // names of a program were resolved when decoding it
+    auto builtin = symbol.program ? symbol.builtin : builtin_name(symbol.str());
 
-    if(val)
+    switch(builtin)
     {
-        return std::shared_ptr<Value>(val);
+    case BuiltinName::NotBuiltin:
+    case BuiltinName::True:
+    case BuiltinName::False:
+        break;
+    case BuiltinName::None:
+        return nullptr;
+    case BuiltinName::Sum:
+    case BuiltinName::Sorted:
+    case BuiltinName::Any:
+    case BuiltinName::All:
+    case BuiltinName::Enumerate:
+    case BuiltinName::Zip:
+    case BuiltinName::Abs:
+        break;
+    default:
+        return get_builtin(builtin);
     }
 
-    auto it = m_values.find(name);
-    if(it == m_values.end())
+    for(auto scope = this; scope; scope = scope->m_parent)
     {
-        if(m_parent)
+        if(auto value = scope->find(symbol))
         {
-            return m_parent->get_value(name);
+            return *value;
         }
+    }
 
-        throw std::runtime_error("No such value: " + name);
+    if(builtin != BuiltinName::NotBuiltin && builtin != BuiltinName::True &&
+       builtin != BuiltinName::False)
+    {
+        return get_builtin(builtin);
     }
 
-    return it->second;
+    throw std::runtime_error("No such value: " + symbol.str());
 }
 
 void Scope::terminate() { m_terminated = true; }
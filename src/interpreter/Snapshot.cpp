@@ -0,0 +1,58 @@
+#include <cowlang/CallableVMFunction.h>
+#include <cowlang/Snapshot.h>
+
+namespace cow
+{
+
+Snapshot::Snapshot(ProgramPtr program, std::vector<Definition> definitions, uint32_t num_execution_steps)
+: m_program(std::move(program)), m_definitions(std::move(definitions)),
+  m_num_execution_steps(num_execution_steps)
+{
+    for(auto &definition : m_definitions)
+    {
+        if(definition.kind != Definition::Kind::Function)
+        {
+            continue;
+        }
+
+        // only functions without defaults are captured, so there are no values to copy
+        std::vector<ValuePtr> defaults(definition.code->params.size());
+        definition.function = wrap_value(new(m_mem) CallableVMFunction(
+        m_mem, m_program, *definition.code, std::move(defaults)));
+        definition.function->make_immortal();
+    }
+}
+
+Snapshot::~Snapshot()
+{
+    for(auto &definition : m_definitions)
+    {
+        if(definition.function)
+        {
+            // immortal values are never freed by their references
+            auto function = definition.function.get();
+            definition.function = nullptr;
+            delete function;
+        }
+    }
+}
+
+size_t Snapshot::memory_usage() const
+{
+    size_t usage = sizeof(*this);
+
+    for(auto &definition : m_definitions)
+    {
+        usage += sizeof(definition) + definition.module.capacity() +
+                 definition.member.capacity() + definition.as_name.capacity();
+
+        if(definition.function)
+        {
+            usage += sizeof(CallableVMFunction);
+        }
+    }
+
+    return usage;
+}
+
+} // namespace cow
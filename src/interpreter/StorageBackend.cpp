@@ -0,0 +1,149 @@
+#include <bitstream.h>
+#include <cowlang/StorageBackend.h>
+#include <stdexcept>
+
+namespace cow
+{
+
+// the version and the number of entries precede the entries of an encoded storage
+static constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t);
+
+void CallbackStorageBackend::load(const std::string &key, StorageState &storage)
+{
+    auto data = m_callback(key);
+    if(data.empty())
+    {
+        storage.copy_key(StorageState(), key);
+    }
+    else
+    {
+        storage.decode(data);
+    }
+}
+
+void StateStorageBackend::load(const std::string &key, StorageState &storage)
+{
+    storage.copy_key(m_state, key);
+}
+
+void FileStorageBackend::write(const std::string &path, const StorageState &storage)
+{
+    auto keys = storage.keys();
+
+    // same as storage.encode(), but keep track of where the entries start
+    bitstream header, index;
+    header << StorageState::ENCODING_VERSION << static_cast<uint32_t>(keys.size());
+
+    std::string data = header.store();
+    for(auto &key : keys)
+    {
+        index << static_cast<uint32_t>(data.size());
+        data += storage.encode({ key }).substr(HEADER_SIZE);
+    }
+
+    index << static_cast<uint32_t>(keys.size());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << data << index.store();
+    if(!file)
+    {
+        throw std::runtime_error("Failed to write storage file " + path);
+    }
+}
+
+FileStorageBackend::FileStorageBackend(const std::string &path)
+: m_file(path, std::ios::binary | std::ios::ate)
+{
+    if(!m_file)
+    {
+        throw std::runtime_error("Failed to open storage file " + path);
+    }
+
+    uint64_t length = m_file.tellg();
+    if(length < HEADER_SIZE + sizeof(uint32_t))
+    {
+        throw std::runtime_error("Invalid storage file " + path);
+    }
+
+    auto trailer = read(length - sizeof(uint32_t), sizeof(uint32_t));
+    bitstream_view(trailer) >> m_size;
+
+    if(length < HEADER_SIZE + sizeof(uint32_t) * (m_size + 1ULL))
+    {
+        throw std::runtime_error("Invalid storage file " + path);
+    }
+
+    m_index_offset = length - sizeof(uint32_t) * (m_size + 1ULL);
+}
+
+void FileStorageBackend::load(const std::string &key, StorageState &storage)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // find the first entry that is not less than key
+    uint32_t begin = 0, end = m_size;
+    while(begin < end)
+    {
+        auto middle = begin + (end - begin) / 2;
+        if(read_key(read_offset(middle)) < key)
+        {
+            begin = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
+    }
+
+    if(begin == m_size || read_key(read_offset(begin)) != key)
+    {
+        storage.copy_key(StorageState(), key);
+        return;
+    }
+
+    auto offset = read_offset(begin);
+    auto next = begin + 1 < m_size ? read_offset(begin + 1) : m_index_offset;
+    if(next < offset)
+    {
+        throw std::runtime_error("Invalid storage file");
+    }
+
+    // decode the entry as a storage of its own
+    bitstream header;
+    header << StorageState::ENCODING_VERSION << static_cast<uint32_t>(1);
+    storage.decode(header.store() + read(offset, next - offset));
+}
+
+std::string FileStorageBackend::read(uint64_t offset, uint32_t length)
+{
+    std::string data(length, '\0');
+    m_file.seekg(offset);
+    m_file.read(&data[0], length);
+    if(!m_file)
+    {
+        throw std::runtime_error("Unexpected EOF in storage file");
+    }
+
+    return data;
+}
+
+uint32_t FileStorageBackend::read_offset(uint32_t index)
+{
+    uint32_t offset;
+    bitstream_view(read(m_index_offset + sizeof(uint32_t) * index, sizeof(uint32_t))) >> offset;
+    return offset;
+}
+
+std::string FileStorageBackend::read_key(uint32_t offset)
+{
+    uint32_t length;
+    bitstream_view(read(offset, sizeof(uint32_t))) >> length;
+    if(offset + sizeof(uint32_t) + length > m_index_offset)
+    {
+        throw std::runtime_error("Invalid storage file");
+    }
+
+    return read(offset + sizeof(uint32_t), length);
+}
+
+} // namespace cow
@@ -0,0 +1,303 @@
+#include "StringMethod.h"
+#include "args.h"
+
+#include <cowlang/Interpreter.h>
+#include <cowlang/List.h>
+
+namespace cow
+{
+
+static uint64_t byte_steps(uint64_t num_bytes)
+{
+    return (num_bytes + StringMethod::BYTES_PER_STEP - 1) / StringMethod::BYTES_PER_STEP;
+}
+
+// std::string::find() may compare the whole substring at every position of the string
+static uint64_t search_steps(const std::string &str, const std::string &sub)
+{
+    return byte_steps(str.size() * std::max<uint64_t>(1, sub.size()));
+}
+
+ValuePtr StringVal::get_member(const std::string &name)
+{
+    StringMethodType type;
+
+    if(name == "join")
+        type = StringMethodType::Join;
+    else if(name == "split")
+        type = StringMethodType::Split;
+    else if(name == "format")
+        type = StringMethodType::Format;
+    else if(name == "startswith")
+        type = StringMethodType::StartsWith;
+    else if(name == "find")
+        type = StringMethodType::Find;
+    else
+        throw language_exception("No such member String::" + name);
+
+    return make_value<StringMethod>(memory_manager(), StringValPtr(this), type);
+}
+
+ValuePtr StringMethod::duplicate(MemoryManager &mem)
+{
+    auto string = value_cast<StringVal>(m_string->duplicate(mem));
+    return make_value<StringMethod>(mem, string, m_type);
+}
+
+ValuePtr StringMethod::call(const std::vector<ValuePtr> &args,
+                            Scope &,
+                            uint32_t &current_num,
+                            uint32_t &current_max)
+{
+    auto &str = m_string->get();
+
+    switch(m_type)
+    {
+    case StringMethodType::Join:
+        check_num_args(args, 1);
+        ASSERT_GENERIC(args[0]);
+        return join(args[0], current_num, current_max);
+    case StringMethodType::Split:
+        return split(args, current_num, current_max);
+    case StringMethodType::Format:
+        return format(args, current_num, current_max);
+    case StringMethodType::StartsWith:
+    {
+        check_num_args(args, 1);
+        check_is_string(args[0]);
+
+        auto &prefix = value_cast<StringVal>(args[0])->get();
+        charge(current_num, current_max, byte_steps(std::min(prefix.size(), str.size())));
+
+        return memory_manager().create_boolean(str.compare(0, prefix.size(), prefix) == 0);
+    }
+    case StringMethodType::Find:
+    {
+        check_num_args(args, 1);
+        check_is_string(args[0]);
+
+        auto &sub = value_cast<StringVal>(args[0])->get();
+        charge(current_num, current_max, search_steps(str, sub));
+
+        auto pos = str.find(sub);
+        return memory_manager().create_integer(pos == std::string::npos ? -1 : int64_t(pos));
+    }
+    default:
+        throw std::runtime_error("Unknown string method");
+    }
+}
+
+ValuePtr StringMethod::join(const ValuePtr &iterable, uint32_t &current_num, uint32_t current_max)
+{
+    auto &separator = m_string->get();
+    auto elements = read_elements(iterable, current_num, current_max);
+
+    size_t size = 0;
+    for(auto &elem : elements)
+    {
+        check_is_string(elem);
+        size += value_cast<StringVal>(elem)->get().size();
+    }
+
+    if(!elements.empty())
+    {
+        size += separator.size() * (elements.size() - 1);
+    }
+
+    charge(current_num, current_max, byte_steps(size));
+
+    std::string result;
+    result.reserve(size);
+
+    for(size_t i = 0; i < elements.size(); ++i)
+    {
+        if(i > 0)
+        {
+            result += separator;
+        }
+
+        result += value_cast<StringVal>(elements[i])->get();
+    }
+
+    return memory_manager().create_string(std::move(result));
+}
+
+ValuePtr StringMethod::split(const std::vector<ValuePtr> &args,
+                             uint32_t &current_num,
+                             uint32_t current_max)
+{
+    auto &str = m_string->get();
+
+    if(args.size() > 1)
+    {
+        throw std::runtime_error("Invalid number of arguments");
+    }
+
+    auto list = memory_manager().create_list();
+
+    if(args.empty())
+    {
+        // runs of whitespace separate the parts, and there are no empty parts
+        static const char *whitespace = " \t\n\r\f\v";
+        charge(current_num, current_max, byte_steps(str.size()));
+
+        size_t pos = str.find_first_not_of(whitespace);
+        while(pos != std::string::npos)
+        {
+            auto end = str.find_first_of(whitespace, pos);
+            if(end == std::string::npos)
+            {
+                end = str.size();
+            }
+
+            charge(current_num, current_max, 1);
+            list->append(memory_manager().create_string(str.substr(pos, end - pos)));
+            pos = str.find_first_not_of(whitespace, end);
+        }
+
+        return list;
+    }
+
+    check_is_string(args[0]);
+    auto &separator = value_cast<StringVal>(args[0])->get();
+
+    if(separator.empty())
+    {
+        throw std::runtime_error("Empty separator");
+    }
+
+    charge(current_num, current_max, search_steps(str, separator));
+
+    size_t pos = 0;
+    while(true)
+    {
+        charge(current_num, current_max, 1);
+
+        auto end = str.find(separator, pos);
+        if(end == std::string::npos)
+        {
+            list->append(memory_manager().create_string(str.substr(pos)));
+            return list;
+        }
+
+        list->append(memory_manager().create_string(str.substr(pos, end - pos)));
+        pos = end + separator.size();
+    }
+}
+
+ValuePtr StringMethod::format(const std::vector<ValuePtr> &args,
+                              uint32_t &current_num,
+                              uint32_t current_max)
+{
+    auto &format = m_string->get();
+    charge(current_num, current_max, byte_steps(format.size()));
+
+    // the format string as literal text and fields, a field refers to an argument
+    struct Piece
+    {
+        size_t begin, length;
+        int64_t argument;
+    };
+
+    std::vector<Piece> pieces;
+    bool automatic = false, manual = false;
+    int64_t next_argument = 0;
+
+    for(size_t pos = 0; pos < format.size();)
+    {
+        auto c = format[pos];
+
+        if((c == '{' || c == '}') && pos + 1 < format.size() && format[pos + 1] == c)
+        {
+            pieces.push_back({ pos, 1, -1 });
+            pos += 2;
+        }
+        else if(c == '{')
+        {
+            auto end = format.find('}', pos);
+            if(end == std::string::npos)
+            {
+                throw std::runtime_error("Single '{' in format string");
+            }
+
+            auto field = format.substr(pos + 1, end - pos - 1);
+            if(field.empty())
+            {
+                automatic = true;
+                pieces.push_back({ 0, 0, next_argument++ });
+            }
+            else if(field.find_first_not_of("0123456789") == std::string::npos && field.size() < 10)
+            {
+                manual = true;
+                pieces.push_back({ 0, 0, std::stoll(field) });
+            }
+            else
+            {
+                throw std::runtime_error("Unsupported format field: " + field);
+            }
+
+            if(automatic && manual)
+            {
+                throw std::runtime_error("Cannot mix automatic and manual field numbering");
+            }
+
+            pos = end + 1;
+        }
+        else if(c == '}')
+        {
+            throw std::runtime_error("Single '}' in format string");
+        }
+        else
+        {
+            auto end = std::min(format.find_first_of("{}", pos), format.size());
+            pieces.push_back({ pos, end - pos, -1 });
+            pos = end;
+        }
+    }
+
+    std::vector<std::string> arguments;
+    arguments.reserve(args.size());
+
+    for(auto &arg : args)
+    {
+        arguments.push_back(arg ? arg->str() : "None");
+    }
+
+    size_t size = 0;
+    for(auto &piece : pieces)
+    {
+        if(piece.argument < 0)
+        {
+            size += piece.length;
+        }
+        else if(static_cast<size_t>(piece.argument) < arguments.size())
+        {
+            size += arguments[piece.argument].size();
+        }
+        else
+        {
+            throw std::runtime_error("Format argument index out of range");
+        }
+    }
+
+    charge(current_num, current_max, byte_steps(size));
+
+    std::string result;
+    result.reserve(size);
+
+    for(auto &piece : pieces)
+    {
+        if(piece.argument < 0)
+        {
+            result.append(format, piece.begin, piece.length);
+        }
+        else
+        {
+            result += arguments[piece.argument];
+        }
+    }
+
+    return memory_manager().create_string(std::move(result));
+}
+
+} // namespace cow
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cowlang/Callable.h>
+#include <cowlang/Value.h>
+
+namespace cow
+{
+
+enum class StringMethodType
+{
+    Join,
+    Split,
+    Format,
+    StartsWith,
+    Find,
+};
+
+/**
+ * A method of a string, bound to that string
+ *
+ * The size of each result is computed before it is built, so it is allocated once. Besides the
+ * step for the call, every method charges one step per BYTES_PER_STEP bytes (rounded up) it
+ * reads or writes. Searching for a substring counts as reading the substring at every position
+ * of the string. join() also charges one step per element it reads and split() one per part.
+ */
+class StringMethod : public Callable
+{
+public:
+    static constexpr uint32_t BYTES_PER_STEP = 32;
+
+    StringMethod(MemoryManager &mem, StringValPtr string, StringMethodType type)
+    : Callable(mem), m_string(std::move(string)), m_type(type)
+    {
+    }
+
+    ValuePtr duplicate(MemoryManager &mem) override;
+
+    ValueType type() const override { return ValueType::Function; }
+
+    ValuePtr call(const std::vector<ValuePtr> &args,
+                  Scope &scope,
+                  uint32_t &current_num,
+                  uint32_t &current_max) override;
+
+private:
+    ValuePtr join(const ValuePtr &iterable, uint32_t &current_num, uint32_t current_max);
+    ValuePtr split(const std::vector<ValuePtr> &args, uint32_t &current_num, uint32_t current_max);
+    ValuePtr format(const std::vector<ValuePtr> &args, uint32_t &current_num, uint32_t current_max);
+
+    StringValPtr m_string;
+    const StringMethodType m_type;
+};
+
+} // namespace cow
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cowlang/Iterator.h>
+#include <cowlang/Tuple.h>
 #include <cowlang/Value.h>
+#include <modules/blockchain_module.h>
 
 namespace cow
 {
@@ -46,4 +50,74 @@ inline bool relaxed_check_is_string(const ValuePtr arg)
     return true;
 }
 
+/**
+ * Charge steps for the work a native function does, in addition to the ones the caller already
+ * took
+ */
+inline void charge(uint32_t &current_num, uint32_t current_max, uint64_t steps)
+{
+    if(current_max > 0 && steps > 0 && current_num + steps >= current_max)
+    {
+        current_num = std::max(current_num + 1, current_max);
+        throw OutOfGasException();
+    }
+
+    current_num += steps;
+}
+
+/**
+ * The elements of a tuple or of anything that can be iterated, one step each
+ */
+inline std::vector<ValuePtr>
+read_elements(const ValuePtr &arg, uint32_t &current_num, uint32_t current_max)
+{
+    std::vector<ValuePtr> result;
+
+    if(arg->type() == ValueType::Tuple)
+    {
+        auto tuple = value_cast<Tuple>(arg);
+        charge(current_num, current_max, tuple->size());
+
+        for(uint32_t i = 0; i < tuple->size(); ++i)
+        {
+            result.push_back(tuple->get(i));
+        }
+
+        return result;
+    }
+
+    IteratorPtr iter = nullptr;
+    if(arg->is_generator())
+    {
+        iter = value_cast<Iterator>(arg);
+    }
+    else if(arg->can_iterate())
+    {
+        iter = value_cast<IterateableValue>(arg)->iterate();
+    }
+    else
+    {
+        throw std::runtime_error("Can't iterate");
+    }
+
+    while(true)
+    {
+        ValuePtr next = nullptr;
+
+        try
+        {
+            next = iter->next();
+        }
+        catch(stop_iteration_exception)
+        {
+            break;
+        }
+
+        charge(current_num, current_max, 1);
+        result.push_back(next);
+    }
+
+    return result;
+}
+
 } // namespace cow
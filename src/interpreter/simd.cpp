@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cowlang/simd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define COW_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace cow
+{
+namespace simd
+{
+
+namespace
+{
+
+using detail::Kernels;
+using detail::Level;
+
+// the scalar kernels also handle what is left over by the vectorized ones
+
+bool contains_scalar(const int64_t *values, size_t size, int64_t value)
+{
+    return std::find(values, values + size, value) != values + size;
+}
+
+int64_t min_scalar(const int64_t *values, size_t size)
+{
+    return *std::min_element(values, values + size);
+}
+
+int64_t max_scalar(const int64_t *values, size_t size)
+{
+    return *std::max_element(values, values + size);
+}
+
+int64_t sum_scalar(const int64_t *values, size_t size)
+{
+    // unsigned arithmetic wraps around instead of overflowing
+    uint64_t result = 0;
+    for(size_t i = 0; i < size; ++i)
+    {
+        result += static_cast<uint64_t>(values[i]);
+    }
+
+    return static_cast<int64_t>(result);
+}
+
+#ifdef COW_SIMD_X86
+
+__attribute__((target("sse4.2")))
+bool contains_sse42(const int64_t *values, size_t size, int64_t value)
+{
+    auto needle = _mm_set1_epi64x(value);
+
+    size_t i = 0;
+    for(; i + 4 <= size; i += 4)
+    {
+        auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+        auto second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 2));
+        auto equal = _mm_or_si128(_mm_cmpeq_epi64(first, needle), _mm_cmpeq_epi64(second, needle));
+
+        if(!_mm_testz_si128(equal, equal))
+            return true;
+    }
+
+    return contains_scalar(values + i, size - i, value);
+}
+
+template <bool Max>
+__attribute__((target("sse4.2")))
+int64_t extreme_sse42(const int64_t *values, size_t size)
+{
+    if(size < 2)
+        return Max ? max_scalar(values, size) : min_scalar(values, size);
+
+    auto result = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+
+    size_t i = 2;
+    for(; i + 2 <= size; i += 2)
+    {
+        auto current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+        auto greater = _mm_cmpgt_epi64(current, result);
+        result = Max ? _mm_blendv_epi8(result, current, greater)
+                     : _mm_blendv_epi8(current, result, greater);
+    }
+
+    int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), result);
+
+    auto extreme = Max ? max_scalar(lanes, 2) : min_scalar(lanes, 2);
+    for(; i < size; ++i)
+    {
+        extreme = Max ? std::max(extreme, values[i]) : std::min(extreme, values[i]);
+    }
+
+    return extreme;
+}
+
+__attribute__((target("sse4.2")))
+int64_t sum_sse42(const int64_t *values, size_t size)
+{
+    auto result = _mm_setzero_si128();
+
+    size_t i = 0;
+    for(; i + 2 <= size; i += 2)
+    {
+        result =
+        _mm_add_epi64(result, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)));
+    }
+
+    int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), result);
+
+    return static_cast<int64_t>(static_cast<uint64_t>(sum_scalar(lanes, 2)) +
+                                static_cast<uint64_t>(sum_scalar(values + i, size - i)));
+}
+
+__attribute__((target("avx2")))
+bool contains_avx2(const int64_t *values, size_t size, int64_t value)
+{
+    auto needle = _mm256_set1_epi64x(value);
+
+    // one cache line per iteration
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        auto first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        auto second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 4));
+        auto equal =
+        _mm256_or_si256(_mm256_cmpeq_epi64(first, needle), _mm256_cmpeq_epi64(second, needle));
+
+        if(!_mm256_testz_si256(equal, equal))
+            return true;
+    }
+
+    return contains_scalar(values + i, size - i, value);
+}
+
+template <bool Max>
+__attribute__((target("avx2")))
+int64_t extreme_avx2(const int64_t *values, size_t size)
+{
+    if(size < 4)
+        return Max ? max_scalar(values, size) : min_scalar(values, size);
+
+    auto result = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values));
+
+    size_t i = 4;
+    for(; i + 4 <= size; i += 4)
+    {
+        auto current = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        auto greater = _mm256_cmpgt_epi64(current, result);
+        result = Max ? _mm256_blendv_epi8(result, current, greater)
+                     : _mm256_blendv_epi8(current, result, greater);
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), result);
+
+    auto extreme = Max ? max_scalar(lanes, 4) : min_scalar(lanes, 4);
+    for(; i < size; ++i)
+    {
+        extreme = Max ? std::max(extreme, values[i]) : std::min(extreme, values[i]);
+    }
+
+    return extreme;
+}
+
+__attribute__((target("avx2")))
+int64_t sum_avx2(const int64_t *values, size_t size)
+{
+    auto result = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for(; i + 4 <= size; i += 4)
+    {
+        result =
+        _mm256_add_epi64(result, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), result);
+
+    // wrapping addition is associative, so the order of the additions does not matter
+    return static_cast<int64_t>(static_cast<uint64_t>(sum_scalar(lanes, 4)) +
+                                static_cast<uint64_t>(sum_scalar(values + i, size - i)));
+}
+
+#endif
+
+const Kernels &kernels()
+{
+    static const Kernels &result = []() -> const Kernels & {
+        for(auto level : { Level::AVX2, Level::SSE42 })
+        {
+            if(auto supported = detail::kernels(level))
+                return *supported;
+        }
+
+        return *detail::kernels(Level::None);
+    }();
+
+    return result;
+}
+
+} // namespace
+
+const Kernels *detail::kernels(Level level)
+{
+    static const Kernels scalar{ contains_scalar, min_scalar, max_scalar, sum_scalar };
+
+#ifdef COW_SIMD_X86
+    static const Kernels sse42{
+        contains_sse42, extreme_sse42<false>, extreme_sse42<true>, sum_sse42
+    };
+    static const Kernels avx2{ contains_avx2, extreme_avx2<false>, extreme_avx2<true>, sum_avx2 };
+
+    if(level == Level::AVX2)
+        return __builtin_cpu_supports("avx2") ? &avx2 : nullptr;
+    if(level == Level::SSE42)
+        return __builtin_cpu_supports("sse4.2") ? &sse42 : nullptr;
+#else
+    if(level != Level::None)
+        return nullptr;
+#endif
+
+    return &scalar;
+}
+
+bool contains(const int64_t *values, size_t size, int64_t value)
+{
+    return kernels().contains(values, size, value);
+}
+
+int64_t min(const int64_t *values, size_t size) { return kernels().min(values, size); }
+
+int64_t max(const int64_t *values, size_t size) { return kernels().max(values, size); }
+
+int64_t sum(const int64_t *values, size_t size) { return kernels().sum(values, size); }
+
+} // namespace simd
+} // namespace cow
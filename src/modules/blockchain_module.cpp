@@ -15,16 +15,16 @@
 #include <stddef.h>
 #include <string.h>
 
-bool addr_check(const char *address)
+bool addr_check(const char *address, cow::net_type net)
 {
 
     if(address == 0)
         return false;
 
     auto mp_chainparams = &btc_chainparams_main;
-    if(cow::net == cow::net_type::TEST)
+    if(net == cow::net_type::TEST)
         mp_chainparams = &btc_chainparams_test;
-    else if(cow::net == cow::net_type::REGTEST)
+    else if(net == cow::net_type::REGTEST)
         mp_chainparams = &btc_chainparams_regtest;
 
     uint8_t buf[strlen(address) * 2];
@@ -88,21 +88,8 @@ const char *OutOfGasException::what() const throw()
 }
 namespace cow
 {
-net_type net = net_type::MAIN;
-/* These are hardcoded default values for easy testing */
-std::string txid = "a1075db55d416d3ca199f55b6084e2115b9345e16c5cf302fc80e9d5fbf5d48d";
-std::string current_block = "00000000000000000015c23c0979270b91c26a562ae62463b85481f1d945bc21";
-std::string previous_block = "0000000000000000002f3cb3939d8685c8976dc9e35ccec08c4e121b12688974";
-uint32_t current_time = 1546659311;
-uint32_t current_height = 1234567;
-uint32_t previous_time = 1546659307;
-std::string sender = "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa";
-std::string contract_address = "1XPTgDRhN8RFnzniWCddobD9iKZatrvH4";
-uint64_t value = (uint64_t)50 * COIN;
-uint64_t contract_balance = (uint64_t)300 * COIN;
-std::map<std::string, uint64_t> send_map;
-
-BlockchainModule::BlockchainModule(MemoryManager &mem) : Module(mem)
+BlockchainModule::BlockchainModule(MemoryManager &mem, ExecutionContext &context)
+: Module(mem), m_context(context)
 {
     // preseed RC4
     for(int i = 0; i < 256; i++)
@@ -138,13 +125,13 @@ BlockchainModule::BlockchainModule(MemoryManager &mem) : Module(mem)
 ValuePtr BlockchainModule::get_current_block(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) StringVal(mem, current_block));
+    return wrap_value(new(mem) StringVal(mem, m_context.current_block));
 }
 
 ValuePtr BlockchainModule::get_txid(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) StringVal(mem, txid));
+    return wrap_value(new(mem) StringVal(mem, m_context.txid));
 }
 
 ValuePtr BlockchainModule::assert_address(Scope &scope)
@@ -162,7 +149,7 @@ ValuePtr BlockchainModule::assert_address(Scope &scope)
     if(a.size() == 0)
         throw std::runtime_error("address cannot be of length zero");
 
-    if(!addr_check(a.c_str()))
+    if(!addr_check(a.c_str(), m_context.net))
         throw std::runtime_error("assert failed: argument is not a valid address");
 
     return wrap_value(new(mem) BoolVal(mem, true));
@@ -180,7 +167,7 @@ ValuePtr BlockchainModule::send(Scope &scope)
     std::string a = p->str();
     if(a.size() == 0)
         throw std::runtime_error("address cannot be of length zero");
-    if(!addr_check(a.c_str()))
+    if(!addr_check(a.c_str(), m_context.net))
         throw std::runtime_error("assert failed: argument is not a valid address");
     // and now, we get the value to be sent
     if(!scope.has_value("value"))
@@ -189,14 +176,15 @@ ValuePtr BlockchainModule::send(Scope &scope)
     if(p == 0)
         throw std::runtime_error("pointer clash");
     int64_t value = unpack_integer(v);
-    if((value <= 0) | ((uint64_t)value > contract_balance))
+    m_context.balance_accessed = true;
+    if((value <= 0) | ((uint64_t)value > m_context.contract_balance))
     {
         throw std::runtime_error("sending nothing or more than the contract balance not allowed");
     }
 
     // Store that data in the send map (outside of the mapped heap)
-    std::map<std::string, uint64_t>::iterator it = send_map.find(a);
-    if(it != send_map.end())
+    std::map<std::string, uint64_t>::iterator it = m_context.send_map.find(a);
+    if(it != m_context.send_map.end())
     {
         uint64_t overflow_check = it->second;
         it->second += value;
@@ -207,12 +195,12 @@ ValuePtr BlockchainModule::send(Scope &scope)
         }
     }
     else
-        send_map[a] = value;
+        m_context.send_map[a] = value;
 
     // now decuct the remaining contract balance
-    uint64_t overflow_check = contract_balance;
-    contract_balance -= value;
-    if(contract_balance >= overflow_check)
+    uint64_t overflow_check = m_context.contract_balance;
+    m_context.contract_balance -= value;
+    if(m_context.contract_balance >= overflow_check)
     {
         throw std::runtime_error(
         "sending produces overflow in contract balance [sender's balance]");
@@ -232,70 +220,72 @@ ValuePtr BlockchainModule::suicide(Scope &scope)
     if(p == 0)
         throw std::runtime_error("pointer clash");
     std::string a = p->str();
+    m_context.balance_accessed = true;
     // Store that data in the send map (outside of the mapped heap)
-    std::map<std::string, uint64_t>::iterator it = send_map.find(a);
-    if(it != send_map.end())
+    std::map<std::string, uint64_t>::iterator it = m_context.send_map.find(a);
+    if(it != m_context.send_map.end())
     {
         uint64_t overflow_check = it->second;
-        it->second += contract_balance;
+        it->second += m_context.contract_balance;
         if(it->second <= overflow_check)
         {
             throw std::runtime_error("sending produces overflow in receiver balance");
         }
     }
     else
-        send_map[a] = contract_balance;
+        m_context.send_map[a] = m_context.contract_balance;
 
-    contract_balance = 0;
+    m_context.contract_balance = 0;
     throw SuicideException();
 }
 
 ValuePtr BlockchainModule::get_previous_block(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) StringVal(mem, previous_block));
+    return wrap_value(new(mem) StringVal(mem, m_context.previous_block));
 }
 
 ValuePtr BlockchainModule::get_sender(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) StringVal(mem, sender));
+    return wrap_value(new(mem) StringVal(mem, m_context.sender));
 }
 
 ValuePtr BlockchainModule::get_contractaddress(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) StringVal(mem, contract_address));
+    return wrap_value(new(mem) StringVal(mem, m_context.contract_address));
 }
 
 ValuePtr BlockchainModule::get_current_time(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) IntVal(mem, current_time));
+    return wrap_value(new(mem) IntVal(mem, m_context.current_time));
 }
 
 ValuePtr BlockchainModule::get_current_height(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) IntVal(mem, current_height));
+    return wrap_value(new(mem) IntVal(mem, m_context.current_height));
 }
 
 ValuePtr BlockchainModule::get_previous_time(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) IntVal(mem, previous_time));
+    return wrap_value(new(mem) IntVal(mem, m_context.previous_time));
 }
 
 ValuePtr BlockchainModule::get_value(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) IntVal(mem, value));
+    return wrap_value(new(mem) IntVal(mem, m_context.value));
 }
 
 ValuePtr BlockchainModule::get_contract_balance(Scope &scope)
 {
     auto &mem = memory_manager();
-    return wrap_value(new(mem) IntVal(mem, contract_balance));
+    m_context.balance_accessed = true;
+    return wrap_value(new(mem) IntVal(mem, m_context.contract_balance));
 }
 
 ValuePtr BlockchainModule::get_random(Scope &scope)
@@ -322,16 +312,17 @@ ValuePtr BlockchainModule::get_member(const std::string &name)
 void BlockchainModule::seed()
 {
     // not seeding with integers because of the big / little endian dilemma
-    prng_seed_bytes((unsigned char *)current_block.c_str(), strlen(current_block.c_str()));
-    prng_seed_bytes((unsigned char *)previous_block.c_str(), strlen(previous_block.c_str()));
-    prng_seed_bytes((unsigned char *)sender.c_str(), strlen(sender.c_str()));
-    prng_seed_bytes((unsigned char *)contract_address.c_str(), strlen(contract_address.c_str()));
-    prng_seed_bytes((unsigned char *)txid.c_str(), strlen(txid.c_str()));
+    for(auto str : { &m_context.current_block, &m_context.previous_block, &m_context.sender,
+                     &m_context.contract_address, &m_context.txid })
+    {
+        prng_seed_bytes((unsigned char *)str->c_str(), strlen(str->c_str()));
+    }
 }
 
 void register_blockchain_module(Interpreter &i)
 {
-    auto v = wrap_value(new(i.memory_manager()) BlockchainModule(i.memory_manager()));
+    auto v = wrap_value(
+    new(i.memory_manager()) BlockchainModule(i.memory_manager(), i.context()));
     i.set_module("blockchain", v);
 };
 
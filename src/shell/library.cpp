@@ -1,9 +1,11 @@
 #include "pypa/parser/error.hh"
 #include "pypa/parser/parser.hh"
 #include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/string.hpp>
+#include <cowlang/ProgramCache.h>
 #include <cowlang/cow.h>
+#include <cowlang/library.h>
 #include <cowlang/unpack.h>
 #include <fstream>
 #include <inttypes.h>
@@ -17,8 +19,11 @@
 using namespace cow;
 
 
-std::stringstream error_buffer;
-std::stringstream stdout_buffer;
+// every thread has buffers of its own, so executions on different threads don't mix up output
+thread_local std::stringstream error_buffer;
+thread_local std::stringstream stdout_buffer;
+thread_local std::map<std::string, uint64_t> sent;
+thread_local std::string storage_delta;
 
 std::string get_errorbuf()
 {
@@ -34,11 +39,16 @@ std::string get_outbuf()
     return out;
 }
 
+std::map<std::string, uint64_t> get_send_map() { return sent; }
+
+std::string get_storage_delta() { return storage_delta; }
+
 void init_cryptopython()
 {
     // deactivate devmode
-    devmode = false;
-    contractmode = false; // special flag if using the "contract interaction shell"
+    auto &context = ExecutionContext::global();
+    context.devmode = false;
+    context.contractmode = false; // special flag if using the "contract interaction shell"
 }
 
 void print_program_output(const std::string &str) { stdout_buffer << str; }
@@ -112,54 +122,155 @@ int execute_program(std::string &raw,
                     std::stringstream &s,
                     std::string &data)
 {
+    ExecutionContext context;
 
-    // possibly throws early on syntax error
+    // make sure to select the correct net
+    context.net = network;
 
-    // set those global fields for the mod blockchain module
-    cow::txid = blkchn.txid;
-    cow::current_block = blkchn.current_block;
-    cow::previous_block = blkchn.previous_block;
-    cow::current_time = blkchn.current_time;
-    cow::previous_time = blkchn.previous_time;
-    cow::current_height = blkchn.current_height;
-    cow::sender = blkchn.sender;
-    cow::contract_address = blkchn.contract_address;
-    cow::value = blkchn.value;
-    cow::contract_balance = blkchn.contract_balance;
+    context.txid = blkchn.txid;
+    context.current_block = blkchn.current_block;
+    context.previous_block = blkchn.previous_block;
+    context.current_time = blkchn.current_time;
+    context.previous_time = blkchn.previous_time;
+    context.current_height = blkchn.current_height;
+    context.sender = blkchn.sender;
+    context.contract_address = blkchn.contract_address;
+    context.value = blkchn.value;
+    context.contract_balance = blkchn.contract_balance;
 
-    // make sure to select the correct net
-    net = network;
+    auto result = execute_program(raw, context, gas, gasprice, used_g, old_storage, s, data);
+    sent = std::move(context.send_map);
+    return result;
+}
+
+static bool is_binary_storage(const std::string &old_storage)
+{
+    return old_storage.size() > 0 &&
+           static_cast<uint8_t>(old_storage[0]) == StorageState::ENCODING_VERSION;
+}
+
+static void read_storage(PersistableDictionary &storage, const std::string &old_storage)
+{
+    if(is_binary_storage(old_storage))
+    {
+        storage.decode(old_storage);
+        return;
+    }
+
+    // storages written before the binary format are boost text archives of one map per type
+    std::map<std::string, std::string> strings;
+    std::map<std::string, int64_t> ints;
+    std::map<std::string, double> doubles;
+    std::map<std::string, bool> bools;
 
-    // clean send maps
-    send_map.clear();
+    std::stringstream ss;
+    ss.str(old_storage);
+    boost::archive::text_iarchive iarch(ss);
+    iarch >> strings;
+    iarch >> ints;
+    iarch >> doubles;
+    iarch >> bools;
+
+    // if a key is in several maps, the first one wins, like it did when reading from them
+    storage.m_elements.insert(strings.begin(), strings.end());
+    storage.m_elements.insert(ints.begin(), ints.end());
+    storage.m_elements.insert(doubles.begin(), doubles.end());
+    storage.m_elements.insert(bools.begin(), bools.end());
+}
+
+/**
+ * Output the storage after a successful execution, or only its delta if it was loaded lazily
+ */
+static void write_storage(PersistableDictionary &storage,
+                          size_t savepoint,
+                          bool lazy,
+                          std::stringstream &s)
+{
+    storage_delta = storage.encode(storage.changed_keys(savepoint));
+    storage.commit(savepoint);
+
+    if(lazy)
+        s << storage_delta;
+    else
+        s << storage.encode();
+}
+
+/**
+ * Undo what a failed execution did to the storage, and output it like it was before
+ */
+static void discard_changes(PersistableDictionary &storage,
+                            size_t savepoint,
+                            bool lazy,
+                            const std::string &old_storage,
+                            std::stringstream &s)
+{
+    storage.rollback(savepoint);
+    storage_delta = storage.encode(std::set<std::string>());
+
+    // the storage is unchanged, so there is no need to serialize it again, unless it was
+    // passed in the legacy format
+    if(lazy)
+        s << storage_delta;
+    else if(is_binary_storage(old_storage))
+        s << old_storage;
+    else
+        s << storage.encode();
+}
+
+static int run_program(std::string &raw,
+                       ExecutionContext &context,
+                       uint64_t gas,
+                       uint32_t gasprice,
+                       uint64_t &used_g,
+                       const std::string &old_storage,
+                       std::shared_ptr<StorageBackend> backend,
+                       std::stringstream &s,
+                       std::string &data)
+{
+    // possibly throws early on syntax error
 
     // init everything
-    DefaultMemoryManager mem_manager;
-    std::string decompressed;
-    snappy::Uncompress(raw.data(), raw.size(), &decompressed);
+    // freed blocks have to be reused, or loops that create temporaries run out of pages. The
+    // manager keeps its pages between calls, so only the first call on a thread touches the pool
+    static thread_local DefaultMemoryManager mem_manager;
+    mem_manager.reset();
+    mem_manager.set_max_pages(context.max_heap_pages);
 
-    bitstream doc(decompressed);
-    Interpreter pyint(doc, mem_manager);
-    std::shared_ptr<PersistableDictionary> stpt = pyint.get_storage_pointer();
+    // contracts are called over and over again, so they are only decoded and initialized the
+    // first time
+    auto &cache = ProgramCache::instance();
+    auto key = ProgramCache::hash(raw);
+    SnapshotPtr snapshot;
+    ProgramPtr program;
+    std::exception_ptr error;
 
-    if(old_storage.size() > 0)
+    try
+    {
+        program = cache.get(key, raw, snapshot);
+    }
+    catch(std::runtime_error &)
+    {
+        // reported below like any other error of the contract, so the storage stays as it is
+        error = std::current_exception();
+        program = std::make_shared<Program>(bitstream_view());
+    }
+
+    Interpreter pyint(program, 0, mem_manager);
+    pyint.set_context(context);
+    PersistableDictionaryPtr stpt = pyint.get_storage_pointer();
+
+    bool lazy = backend != nullptr;
+    if(lazy)
+    {
+        stpt->set_backend(std::move(backend));
+    }
+    else if(old_storage.size() > 0)
     {
-        // unserializa old storage
-        /*
-        std::map<std::string, std::string> m_elements_string;
-        std::map<std::string, int64_t> m_elements_int;
-        std::map<std::string, double> m_elements_double;
-        std::map<std::string, bool> m_elements_bool;
-        */
-        std::stringstream ss;
-        ss.str(old_storage);
-        boost::archive::text_iarchive iarch(ss);
-        iarch >> stpt->m_elements_string;
-        iarch >> stpt->m_elements_int;
-        iarch >> stpt->m_elements_double;
-        iarch >> stpt->m_elements_bool;
+        read_storage(*stpt, old_storage);
     }
 
+    // failed executions must not change the storage
+    auto savepoint = stpt->savepoint();
 
     uint64_t limit = gas;
     limit /= gasprice;
@@ -168,31 +279,37 @@ int execute_program(std::string &raw,
 
     try
     {
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+
         // Go for it
-        pyint.execute(); // make print also print to a buffer
+        if(snapshot)
+        {
+            pyint.restore(snapshot);
+        }
+        else
+        {
+            pyint.execute(); // make print also print to a buffer
+
+            if(auto initialized = pyint.snapshot())
+            {
+                cache.set_snapshot(key, initialized);
+            }
+        }
+
         // and now call either the default function or some other function
         pyint.calldata(data);
 
         used_g = (pyint.num_execution_steps()) * gasprice;
-        {
-            boost::archive::text_oarchive oarch(s);
-            oarch << stpt->m_elements_string;
-            oarch << stpt->m_elements_int;
-            oarch << stpt->m_elements_double;
-            oarch << stpt->m_elements_bool;
-        }
+        write_storage(*stpt, savepoint, lazy, s);
         return 0;
     }
     catch(OutOfGasException &e)
     {
         used_g = (pyint.num_execution_steps()) * gasprice;
-        {
-            boost::archive::text_oarchive oarch(s);
-            oarch << stpt->m_elements_string;
-            oarch << stpt->m_elements_int;
-            oarch << stpt->m_elements_double;
-            oarch << stpt->m_elements_bool;
-        }
+        discard_changes(*stpt, savepoint, lazy, old_storage, s);
         error_buffer << "ContractError: " << e.what();
         error_buffer << std::endl;
         return 0x70;
@@ -200,13 +317,7 @@ int execute_program(std::string &raw,
     catch(SuicideException &e)
     {
         used_g = (pyint.num_execution_steps()) * gasprice;
-        {
-            boost::archive::text_oarchive oarch(s);
-            oarch << stpt->m_elements_string;
-            oarch << stpt->m_elements_int;
-            oarch << stpt->m_elements_double;
-            oarch << stpt->m_elements_bool;
-        }
+        write_storage(*stpt, savepoint, lazy, s);
         error_buffer << "ContractError: " << e.what();
         error_buffer << std::endl;
         return 0x69;
@@ -214,13 +325,7 @@ int execute_program(std::string &raw,
     catch(RevertException &e)
     {
         used_g = (pyint.num_execution_steps()) * gasprice;
-        {
-            boost::archive::text_oarchive oarch(s);
-            oarch << stpt->m_elements_string;
-            oarch << stpt->m_elements_int;
-            oarch << stpt->m_elements_double;
-            oarch << stpt->m_elements_bool;
-        }
+        discard_changes(*stpt, savepoint, lazy, old_storage, s);
         error_buffer << "ContractError: " << e.what();
         error_buffer << std::endl;
         return 0x71;
@@ -228,16 +333,34 @@ int execute_program(std::string &raw,
     catch(std::exception &e)
     {
         used_g = (pyint.num_execution_steps()) * gasprice;
-        {
-            boost::archive::text_oarchive oarch(s);
-            oarch << stpt->m_elements_string;
-            oarch << stpt->m_elements_int;
-            oarch << stpt->m_elements_double;
-            oarch << stpt->m_elements_bool;
-        }
+        discard_changes(*stpt, savepoint, lazy, old_storage, s);
 
         error_buffer << "ContractError: " << e.what();
         error_buffer << std::endl;
         return 0x80;
     }
 }
+
+int execute_program(std::string &raw,
+                    ExecutionContext &context,
+                    uint64_t gas,
+                    uint32_t gasprice,
+                    uint64_t &used_g,
+                    std::string &old_storage,
+                    std::stringstream &s,
+                    std::string &data)
+{
+    return run_program(raw, context, gas, gasprice, used_g, old_storage, nullptr, s, data);
+}
+
+int execute_program(std::string &raw,
+                    ExecutionContext &context,
+                    uint64_t gas,
+                    uint32_t gasprice,
+                    uint64_t &used_g,
+                    std::shared_ptr<StorageBackend> backend,
+                    std::stringstream &s,
+                    std::string &data)
+{
+    return run_program(raw, context, gas, gasprice, used_g, std::string(), backend, s, data);
+}
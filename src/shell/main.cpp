@@ -18,11 +18,6 @@
 
 using namespace cow;
 
-namespace cow
-{
-extern size_t DEFAULT_MAXIMUM_HEAP_PAGES;
-}
-
 // attribute flags
 #define FL_PRINT (0x01)
 #define FL_SPACE (0x02)
@@ -65,6 +60,9 @@ uint32_t gas = 5000000;
 uint32_t gasprice = 100;
 uint32_t pagelimit = DEFAULT_MAXIMUM_HEAP_PAGES;
 
+// environment of the executions of the shell
+ExecutionContext context;
+
 
 std::string printsize(uint32_t size, bool bytes = true)
 {
@@ -292,7 +290,7 @@ void handle_src_file(std::string &filename, Interpreter &pyint, std::string &dat
         {
             std::ifstream input(filename, std::ios::binary);
             std::string str((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
-            pyint.re_assign_bitstream(str);
+            pyint.re_assign_bitstream(bitstream_view(str));
             pyint.execute();
             pyint.calldata(data);
         }
@@ -302,7 +300,7 @@ void handle_src_file(std::string &filename, Interpreter &pyint, std::string &dat
             std::string str((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
             std::string decompressed;
             snappy::Uncompress(str.data(), str.size(), &decompressed);
-            pyint.re_assign_bitstream(decompressed);
+            pyint.re_assign_bitstream(bitstream_view(decompressed));
             pyint.execute();
             pyint.calldata(data);
         }
@@ -522,9 +520,10 @@ int usage(char **argv)
            "-v [N]         : the amount that was sent in this transaction [default: %" PRIu64 "]\n"
            "-V [N]         : the contract's current balance [default: %" PRIu64 "]\n"
            "\n",
-           argv[0], cow::txid.c_str(), cow::current_block.c_str(), cow::previous_block.c_str(),
-           cow::current_time, cow::previous_time, cow::current_height, cow::sender.c_str(),
-           cow::contract_address.c_str(), cow::value, cow::contract_balance);
+           argv[0], context.txid.c_str(), context.current_block.c_str(),
+           context.previous_block.c_str(), context.current_time, context.previous_time,
+           context.current_height, context.sender.c_str(), context.contract_address.c_str(),
+           context.value, context.contract_balance);
 
     return 1;
 }
@@ -543,7 +542,7 @@ int pre_process_options(int argc, char **argv)
             }
             else if(strcmp(argv[a], "-b") == 0)
             {
-                cow::current_block = argv[a + 1];
+                context.current_block = argv[a + 1];
                 skip++;
             }
             else if(strcmp(argv[a], "-x") == 0)
@@ -556,41 +555,41 @@ int pre_process_options(int argc, char **argv)
             }
             else if(strcmp(argv[a], "-B") == 0)
             {
-                cow::previous_block = argv[a + 1];
+                context.previous_block = argv[a + 1];
                 skip++;
             }
             else if(strcmp(argv[a], "-t") == 0)
             {
-                cow::current_time = atoi(argv[a + 1]);
+                context.current_time = atoi(argv[a + 1]);
                 skip++;
             }
             else if(strcmp(argv[a], "-T") == 0)
             {
-                cow::previous_time = atoi(argv[a + 1]);
+                context.previous_time = atoi(argv[a + 1]);
                 skip++;
             }
             else if(strcmp(argv[a], "-H") == 0)
             {
-                cow::current_height = atoi(argv[a + 1]);
+                context.current_height = atoi(argv[a + 1]);
                 skip++;
             }
             else if(strcmp(argv[a], "-s") == 0)
             {
-                cow::sender = argv[a + 1];
+                context.sender = argv[a + 1];
             }
             else if(strcmp(argv[a], "-a") == 0)
             {
-                cow::contract_address = argv[a + 1];
+                context.contract_address = argv[a + 1];
                 skip++;
             }
             else if(strcmp(argv[a], "-v") == 0)
             {
-                cow::value = atol(argv[a + 1]);
+                context.value = atol(argv[a + 1]);
                 skip++;
             }
             else if(strcmp(argv[a], "-V") == 0)
             {
-                cow::contract_balance = atol(argv[a + 1]);
+                context.contract_balance = atol(argv[a + 1]);
                 skip++;
             }
             else if(strcmp(argv[a], "-g") == 0)
@@ -610,17 +609,17 @@ int pre_process_options(int argc, char **argv)
                     exit(usage(argv));
                 }
                 if(_net == 0)
-                    net = net_type::MAIN;
+                    context.net = net_type::MAIN;
                 if(_net == 1)
-                    net = net_type::TEST;
+                    context.net = net_type::TEST;
                 if(_net == 2)
-                    net = net_type::REGTEST;
+                    context.net = net_type::REGTEST;
             }
             else if(strcmp(argv[a], "-m") == 0)
             {
                 pagelimit = atoi(argv[a + 1]);
                 skip++;
-                DEFAULT_MAXIMUM_HEAP_PAGES = pagelimit;
+                context.max_heap_pages = pagelimit;
             }
         }
     }
@@ -634,8 +633,8 @@ int main(int argc, char *argv[])
     {
 
         // activate devmode, e.g., certain interactive features like Clear() and ClearLimits()
-        devmode = true;
-        contractmode = false; // special flag if using the "contract interaction shell"
+        context.devmode = true;
+        context.contractmode = false; // special flag if using the "contract interaction shell"
 
         // initialize default mem mem_manager
         // this basically is a virtual, size-limited heap
@@ -654,8 +653,11 @@ int main(int argc, char *argv[])
             input = argv[argc - 1];
         }
 
+        mem_manager.set_max_pages(context.max_heap_pages);
+
         auto doc = compile_string("");
         Interpreter pyint(doc, mem_manager);
+        pyint.set_context(context);
         uint64_t limit = gas;
         limit /= gasprice;
         pyint.set_execution_step_limit((uint32_t)limit);
@@ -696,14 +698,14 @@ int main(int argc, char *argv[])
                       << "-------------------------------------------------------------------"
                       << termcolor::reset << std::endl;
 
-            std::map<std::string, uint64_t>::iterator it = send_map.begin();
-            if(it == send_map.end())
+            std::map<std::string, uint64_t>::iterator it = context.send_map.begin();
+            if(it == context.send_map.end())
             {
                 std::cout << termcolor::reset << termcolor::cyan << "| " << termcolor::reset
                           << std::setw(63) << "The send table has no entries" << termcolor::reset
                           << termcolor::cyan << " |" << termcolor::reset << std::endl;
             }
-            while(it != send_map.end())
+            while(it != context.send_map.end())
             {
                 std::cout << termcolor::reset << termcolor::cyan << "| " << termcolor::reset
                           << std::setw(40) << it->first << termcolor::reset << termcolor::cyan << " | "
@@ -0,0 +1,165 @@
+#include <cowlang/BlockExecutor.h>
+#include <cowlang/cow.h>
+#include <gtest/gtest.h>
+
+namespace cow
+{
+
+class BlockExecutorTest : public ::testing::Test
+{
+};
+
+TEST(BlockExecutorTest, conflicts_are_executed_in_order)
+{
+    const std::string code = "def default():\n"
+                             "  store['count'] += 1\n"
+                             "  print(store['count'])\n";
+
+    auto raw = compile_string(code).store();
+    auto program = std::make_shared<Program>(bitstream_view(raw));
+
+    BlockExecutor executor(4);
+    executor.storage("b").m_elements["count"] = int64_t(10);
+
+    std::vector<std::string> outputs(10);
+    std::vector<BlockExecutor::Transaction> transactions(outputs.size());
+    for(size_t i = 0; i < transactions.size(); ++i)
+    {
+        auto &transaction = transactions[i];
+        transaction.program = program;
+        transaction.storage = i % 2 ? "b" : "a";
+        transaction.execution_step_limit = 100000;
+        transaction.context.output = [&outputs, i](const std::string &str) { outputs[i] += str; };
+    }
+
+    auto results = executor.execute(transactions);
+
+    ASSERT_EQ(transactions.size(), results.size());
+    for(size_t i = 0; i < transactions.size(); ++i)
+    {
+        int64_t count = (i % 2 ? 10 : 0) + i / 2 + 1;
+        EXPECT_EQ(nullptr, results[i].error);
+        EXPECT_EQ(i >= 2, results[i].reexecuted);
+        EXPECT_EQ(std::to_string(count) + "\n", outputs[i]);
+    }
+
+    EXPECT_EQ(5, std::get<int64_t>(executor.storage("a").m_elements["count"]));
+    EXPECT_EQ(15, std::get<int64_t>(executor.storage("b").m_elements["count"]));
+}
+
+TEST(BlockExecutorTest, disjoint_keys_do_not_conflict)
+{
+    const std::string code = "def default():\n"
+                             "  store[sender()] = 1\n"
+                             "from blockchain import sender\n";
+
+    auto raw = compile_string(code).store();
+    auto program = std::make_shared<Program>(bitstream_view(raw));
+    const std::vector<std::string> senders = { "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa",
+                                               "1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN2" };
+
+    BlockExecutor executor;
+    std::vector<BlockExecutor::Transaction> transactions(senders.size());
+    for(size_t i = 0; i < transactions.size(); ++i)
+    {
+        transactions[i].program = program;
+        transactions[i].storage = "contract";
+        transactions[i].execution_step_limit = 100000;
+        transactions[i].context.sender = senders[i];
+    }
+
+    auto results = executor.execute(transactions);
+
+    for(size_t i = 0; i < transactions.size(); ++i)
+    {
+        EXPECT_EQ(nullptr, results[i].error);
+        EXPECT_FALSE(results[i].reexecuted);
+        EXPECT_EQ(1, std::get<int64_t>(executor.storage("contract").m_elements[senders[i]]));
+    }
+}
+
+TEST(BlockExecutorTest, sends_spend_the_balance_left_by_earlier_ones)
+{
+    const std::string code = "def default():\n"
+                             "  send(sender(), 200)\n"
+                             "from blockchain import send, sender\n";
+
+    auto raw = compile_string(code).store();
+    auto program = std::make_shared<Program>(bitstream_view(raw));
+
+    // each send fits into the balance, but not both
+    BlockExecutor executor;
+    std::vector<BlockExecutor::Transaction> transactions(2);
+    for(auto &transaction : transactions)
+    {
+        transaction.program = program;
+        transaction.storage = "contract";
+        transaction.execution_step_limit = 100000;
+        transaction.context.contract_balance = 300;
+    }
+
+    auto results = executor.execute(transactions);
+
+    EXPECT_EQ(nullptr, results[0].error);
+    EXPECT_NE(nullptr, results[1].error);
+    EXPECT_TRUE(results[1].reexecuted);
+    EXPECT_EQ(100, transactions[0].context.contract_balance);
+    EXPECT_EQ(100, executor.balance("contract"));
+}
+
+TEST(BlockExecutorTest, temporaries_are_reused)
+{
+    // every iteration creates a new integer, which only fits into the heap if memory is reused
+    const std::string code = "def default():\n"
+                             "  total = 0\n"
+                             "  for i in range(200000):\n"
+                             "    total += i\n"
+                             "  print(total)\n";
+
+    auto raw = compile_string(code).store();
+
+    BlockExecutor executor(1);
+    std::string output;
+    std::vector<BlockExecutor::Transaction> transactions(1);
+    transactions[0].program = std::make_shared<Program>(bitstream_view(raw));
+    transactions[0].storage = "contract";
+    transactions[0].execution_step_limit = 10000000;
+    transactions[0].context.output = [&output](const std::string &str) { output += str; };
+
+    auto results = executor.execute(transactions);
+
+    EXPECT_EQ(nullptr, results[0].error);
+    EXPECT_EQ("19999900000\n", output);
+}
+
+TEST(BlockExecutorTest, memory_is_reset_between_transactions)
+{
+    // the list refers to itself, so it is never freed and takes more than half of the heap
+    const std::string code = "def default():\n"
+                             "  l = [0]\n"
+                             "  l.append(l)\n"
+                             "  for i in range(12000):\n"
+                             "    l.append(i + 1000000)\n"
+                             "  print(len(l))\n";
+
+    auto raw = compile_string(code).store();
+    auto program = std::make_shared<Program>(bitstream_view(raw));
+
+    BlockExecutor executor(1);
+    std::vector<BlockExecutor::Transaction> transactions(3);
+    for(auto &transaction : transactions)
+    {
+        transaction.program = program;
+        transaction.storage = "contract";
+        transaction.execution_step_limit = 1000000;
+        transaction.context.max_heap_pages = 1;
+        transaction.context.output = [](const std::string &) {};
+    }
+
+    for(auto &result : executor.execute(transactions))
+    {
+        EXPECT_EQ(nullptr, result.error);
+    }
+}
+
+} // namespace cow
@@ -0,0 +1,84 @@
+#include <cowlang/cow.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+
+using namespace cow;
+
+class BuiltinTest : public testing::Test
+{
+};
+
+static std::string run(const std::string &body, uint32_t *num_steps = nullptr)
+{
+    auto doc = compile_string("def default():\n" + body);
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000000);
+    pyint.execute();
+
+    std::string data;
+    auto res = pyint.calldata(data);
+
+    if(num_steps)
+    {
+        *num_steps = pyint.num_execution_steps();
+    }
+
+    return unpack_string(res);
+}
+
+TEST(BuiltinTest, aggregates)
+{
+    EXPECT_EQ("6", run("    return str(sum([1, 2, 3]))"));
+    EXPECT_EQ("[1, 2, 3]", run("    return str(sorted([3, 1, 2]))"));
+    EXPECT_EQ("['a', 'b']", run("    return str(sorted(['b', 'a']))"));
+    EXPECT_EQ("01", run("    return str(any([0, 0])) + str(all([1, 2]))"));
+    EXPECT_EQ("5 5", run("    return str(abs(-5)) + ' ' + str(abs(5))"));
+
+    EXPECT_EQ("[0, 1, 2]", run("    res = []\n"
+                               "    for i, x in enumerate(['a', 'b', 'c']):\n"
+                               "        res.append(i)\n"
+                               "    return str(res)"));
+
+    EXPECT_EQ("[4, 6]", run("    res = []\n"
+                            "    for x, y in zip([1, 2, 3], [3, 4]):\n"
+                            "        res.append(x + y)\n"
+                            "    return str(res)"));
+
+    EXPECT_THROW(run("    return str(sorted([1, 'a']))"), std::runtime_error);
+}
+
+TEST(BuiltinTest, variables_shadow_new_builtins)
+{
+    EXPECT_EQ("3", run("    sum = 0\n"
+                       "    for x in [1, 2]:\n"
+                       "        sum = sum + x\n"
+                       "    return str(sum)"));
+}
+
+TEST(BuiltinTest, cost_depends_on_input_size)
+{
+    auto sort_steps = [](const std::string &list) {
+        uint32_t plain, sorted;
+        run("    l = " + list + "\n    return str(l)", &plain);
+        run("    l = " + list + "\n    return str(sorted(l))", &sorted);
+        return sorted - plain;
+    };
+
+    // sorting 4 elements costs 4 * (1 + 2) steps, sorting 8 costs 8 * (1 + 3)
+    EXPECT_EQ(sort_steps("[5, 1, 4, 2]") + 8 * 4 - 4 * 3, sort_steps("[5, 1, 4, 2, 3, 8, 7, 6]"));
+    EXPECT_EQ(sort_steps("[1, 2, 3, 4]"), sort_steps("[4, 3, 2, 1]"));
+}
+
+TEST(BuiltinTest, cost_of_min_and_max)
+{
+    auto steps = [](const std::string &call) {
+        uint32_t num_steps;
+        run("    l = [3, 1, 2, 5]\n    return str(" + call + ")", &num_steps);
+        return num_steps;
+    };
+
+    // unlike len(), they read every element of the list
+    EXPECT_EQ(steps("len(l)") + 4, steps("min(l)"));
+    EXPECT_EQ(steps("len(l)") + 4, steps("max(l)"));
+}
@@ -0,0 +1,75 @@
+#include <cowlang/cow.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+
+using namespace cow;
+
+class DictionaryTest : public testing::Test
+{
+};
+
+TEST(DictionaryTest, items_are_in_insertion_order)
+{
+    const std::string code = "def default():\n"
+                             "    res = []\n"
+                             "    dict = {'c':1, 'a':2}\n"
+                             "    dict['b'] = 3\n"
+                             "    dict['c'] = 4\n"
+                             "    for k,v in dict.items():\n"
+                             "        res.append(k)\n"
+                             "    return str(res)";
+
+    auto doc = compile_string(code);
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ("['c', 'a', 'b']", unpack_string(pyint.calldata(data)));
+}
+
+TEST(DictionaryTest, grows_beyond_a_segment)
+{
+    const int64_t SIZE = 20000;
+
+    DefaultMemoryManager mem;
+    auto dict = mem.create_dictionary();
+
+    for(int64_t i = 0; i < SIZE; ++i)
+    {
+        dict->insert(std::to_string(i), mem.create_integer(i));
+    }
+
+    dict->insert("42", mem.create_integer(-1));
+
+    ASSERT_EQ(SIZE, dict->size());
+    EXPECT_EQ(-1, unpack_integer(dict->get("42")));
+    EXPECT_EQ(SIZE - 1, unpack_integer(dict->get(std::to_string(SIZE - 1))));
+    EXPECT_EQ(nullptr, dict->get("foo"));
+
+    auto it = dict->iterate();
+    for(int64_t i = 0; i < SIZE; ++i)
+    {
+        EXPECT_EQ(i == 42 ? -1 : i, unpack_integer(it->next()));
+    }
+
+    EXPECT_THROW(it->next(), stop_iteration_exception);
+}
+
+TEST(DictionaryTest, keys_are_allocated_on_the_heap)
+{
+    const std::string key(1000, 'k');
+
+    DefaultMemoryManager mem;
+    auto dict = mem.create_dictionary();
+    dict->insert("", mem.create_integer(1));
+
+    auto used = mem.get_mem();
+    dict->insert(key, mem.create_integer(2));
+
+    EXPECT_LE(used + key.size(), mem.get_mem());
+    EXPECT_EQ(2, unpack_integer(dict->get(key)));
+    EXPECT_EQ(1, unpack_integer(dict->get("")));
+    EXPECT_EQ(nullptr, dict->get(std::string(999, 'k')));
+}
@@ -0,0 +1,63 @@
+#include <cowlang/cow.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+#include <modules/blockchain_module.h>
+#include <thread>
+
+namespace cow
+{
+
+class ExecutionContextTest : public ::testing::Test
+{
+};
+
+TEST(ExecutionContextTest, concurrent_executions)
+{
+    const std::string code = "def default():\n"
+                             "  print(sender())\n"
+                             "  suicide(sender())\n"
+                             "from blockchain import sender, suicide\n";
+
+    auto doc = compile_string(code);
+    const std::vector<std::string> senders = { "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa",
+                                               "1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN2" };
+
+    std::vector<ExecutionContext> contexts(8);
+    std::vector<std::string> outputs(contexts.size());
+    std::vector<std::thread> threads;
+
+    for(size_t i = 0; i < contexts.size(); ++i)
+    {
+        auto &context = contexts[i];
+        context.sender = senders[i % senders.size()];
+        context.contract_balance = 1000 + i;
+        context.output = [&outputs, i](const std::string &str) { outputs[i] += str; };
+
+        threads.emplace_back([&doc, &context]() {
+            DefaultMemoryManager mem;
+            Interpreter pyint(doc, mem);
+            pyint.set_context(context);
+            pyint.set_execution_step_limit(100000);
+            register_blockchain_module(pyint);
+
+            std::string data;
+            EXPECT_NO_THROW(pyint.execute());
+            EXPECT_THROW(pyint.calldata(data), SuicideException);
+        });
+    }
+
+    for(auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    for(size_t i = 0; i < contexts.size(); ++i)
+    {
+        auto &sender = senders[i % senders.size()];
+        EXPECT_EQ(sender + "\n", outputs[i]);
+        EXPECT_EQ(1000 + i, contexts[i].send_map[sender]);
+        EXPECT_EQ(0, contexts[i].contract_balance);
+    }
+}
+
+} // namespace cow
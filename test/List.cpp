@@ -0,0 +1,70 @@
+#include <cowlang/cow.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+
+using namespace cow;
+
+class ListTest : public testing::Test
+{
+};
+
+TEST(ListTest, integers_are_unboxed)
+{
+    DummyMemoryManager mem;
+    auto list = mem.create_list();
+
+    for(int64_t i = 0; i < 100; ++i)
+    {
+        list->append(mem.create_integer(i * 2));
+    }
+
+    ASSERT_NE(nullptr, list->integers());
+    EXPECT_EQ(100, list->size());
+    EXPECT_EQ(42, unpack_integer(list->get(21)));
+    EXPECT_EQ(198, unpack_integer(list->get(-1)));
+    EXPECT_TRUE(list->contains(*mem.create_integer(42)));
+    EXPECT_FALSE(list->contains(*mem.create_integer(43)));
+    EXPECT_FALSE(list->contains(*mem.create_string("42")));
+}
+
+TEST(ListTest, mixed_elements_are_boxed)
+{
+    const std::string code = "def default():\n"
+                             "    l = [1, 2]\n"
+                             "    l.append('foo')\n"
+                             "    l.append(3)\n"
+                             "    res = []\n"
+                             "    for x in l:\n"
+                             "        res.append(x)\n"
+                             "    return str(res) + str(len(l)) + str('foo' in l) + str(2 in l)";
+
+    auto doc = compile_string(code);
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ("[1, 2, 'foo', 3]411", unpack_string(pyint.calldata(data)));
+}
+
+TEST(ListTest, elements_count_against_the_heap_limit)
+{
+    // two pages hold fewer than a million elements of eight bytes
+    auto fill = [](ValuePtr first) {
+        DefaultMemoryManager mem;
+        mem.set_max_pages(2);
+
+        auto list = mem.create_list();
+        list->append(first);
+
+        for(int64_t i = 0; i < 1000000; ++i)
+        {
+            list->append(mem.create_integer(5));
+        }
+    };
+
+    DummyMemoryManager values;
+    EXPECT_THROW(fill(values.create_integer(5)), std::runtime_error);
+    EXPECT_THROW(fill(nullptr), std::runtime_error);
+}
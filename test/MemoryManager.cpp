@@ -1,4 +1,5 @@
 #include <cowlang/Object.h>
+#include <cowlang/Value.h>
 #include <gtest/gtest.h>
 
 
@@ -133,4 +134,156 @@ TEST(MemoryManager, realloc)
     EXPECT_EQ('F', buf[12]);
 }
 
+TEST(MemoryManager, invalid_free)
+{
+    DefaultMemoryManager mem;
+    int not_managed = 0;
+
+    auto ptr = mem.malloc(50);
+    mem.free(ptr);
+
+    EXPECT_THROW(mem.free(ptr), std::runtime_error);
+    EXPECT_THROW(mem.free(&not_managed), std::runtime_error);
+}
+
+TEST(MemoryManager, interior_free)
+{
+    DefaultMemoryManager mem;
+
+    // the payload looks like the header of a block that is in use
+    auto ptr = reinterpret_cast<uint32_t *>(mem.malloc(64));
+    ptr[0] = 0;
+    ptr[1] = 0x75736564;
+
+    try
+    {
+        mem.free(ptr + 2);
+        FAIL() << "freeing a pointer into a block succeeded";
+    }
+    catch(std::runtime_error &e)
+    {
+        EXPECT_EQ(std::string("Memory error!"), e.what());
+    }
+
+    mem.free(ptr);
+}
+
+TEST(MemoryManager, page_limit)
+{
+    DefaultMemoryManager mem;
+    constexpr size_t SIZE = 1000;
+
+    std::vector<void *> ptrs;
+    EXPECT_THROW(
+    while(true) { ptrs.push_back(mem.malloc(SIZE)); }, std::runtime_error);
+
+    EXPECT_LE(ptrs.size() * SIZE, mem.get_max_mem());
+    EXPECT_GT(ptrs.size() * SIZE, mem.get_max_mem() - DefaultMemoryManager::PAGE_SIZE);
+
+    // freed memory can be used again
+    mem.free(ptrs.back());
+    EXPECT_EQ(ptrs.back(), mem.malloc(SIZE));
+}
+
+TEST(MemoryManager, reset)
+{
+    auto &pool = PagePool::instance();
+    DefaultMemoryManager mem;
+    constexpr size_t SIZE = 1000;
+
+    std::vector<void *> ptrs;
+    EXPECT_THROW(
+    while(true) { ptrs.push_back(mem.malloc(SIZE)); }, std::runtime_error);
+
+    auto available = pool.size();
+    mem.reset();
+
+    // the pages are kept, and blocks from before are gone
+    EXPECT_EQ(available, pool.size());
+    EXPECT_EQ(0, mem.get_mem());
+    EXPECT_THROW(mem.free(ptrs[1]), std::runtime_error);
+    EXPECT_EQ(ptrs[0], mem.malloc(SIZE));
+
+    // kept pages still count against the limit
+    mem.reset();
+    mem.set_max_pages(1);
+
+    size_t num_allocs = 0;
+    EXPECT_THROW(
+    while(true) {
+        mem.malloc(SIZE);
+        num_allocs += 1;
+    },
+    std::runtime_error);
+
+    EXPECT_LE(num_allocs * SIZE, mem.get_max_mem());
+    EXPECT_LT(num_allocs, ptrs.size());
+}
+
+TEST(MemoryManager, page_pool)
+{
+    auto &pool = PagePool::instance();
+    pool.reserve(2);
+    EXPECT_LE(2, pool.size());
+
+    auto available = pool.size();
+    uint8_t *ptr = nullptr;
+    pool.set_scrub(PagePool::Scrub::Zero);
+
+    {
+        DefaultMemoryManager mem;
+        EXPECT_EQ(available - 1, pool.size());
+
+        ptr = reinterpret_cast<uint8_t *>(mem.malloc(50));
+        memset(ptr, 1, 50);
+    }
+
+    pool.set_scrub(PagePool::Scrub::None);
+    EXPECT_EQ(available, pool.size());
+
+    // the page went back into the pool and was zeroed on the way
+    auto page = pool.acquire();
+    EXPECT_TRUE(ptr >= page && ptr < page + PagePool::PAGE_SIZE);
+    EXPECT_EQ(0, ptr[0]);
+    pool.release(page);
+}
+
+class CountingMemoryManager : public DummyMemoryManager
+{
+public:
+    void *malloc(size_t sz) override
+    {
+        num_allocs += 1;
+        return DummyMemoryManager::malloc(sz);
+    }
+
+    void free(void *ptr) override
+    {
+        num_allocs -= 1;
+        DummyMemoryManager::free(ptr);
+    }
+
+    int num_allocs = 0;
+};
+
+TEST(MemoryManager, value_lifetime)
+{
+    CountingMemoryManager mem;
+
+    {
+        ValuePtr value = mem.create_string("foo");
+        EXPECT_EQ(1, mem.num_allocs);
+
+        auto copy = value;
+        auto str = value_cast<StringVal>(copy);
+        value = nullptr;
+        copy = nullptr;
+
+        EXPECT_EQ(1, mem.num_allocs);
+        EXPECT_EQ("foo", str->get());
+    }
+
+    EXPECT_EQ(0, mem.num_allocs);
+}
+
 } // namespace cow
@@ -83,3 +83,98 @@ TEST(PersistencyTest, super_bad_nonstring_subscript_on_nonarray)
     register_blockchain_module(pyint);
     ASSERT_THROW(pyint.execute(), std::exception);
 }
+
+TEST(PersistencyTest, rollback_to_savepoint)
+{
+    DummyMemoryManager mem;
+    auto store = make_value<PersistableDictionary>(mem);
+    store->insert("a", mem.create_integer(1));
+
+    auto outer = store->savepoint();
+    store->apply("a", mem.create_integer(1), BinaryOpType::Add);
+    store->insert("b", mem.create_boolean(true));
+
+    auto inner = store->savepoint();
+    store->insert("a", wrap_value(new(mem) StringVal(mem, "x")));
+    store->insert("b", mem.create_integer(5));
+
+    store->rollback(inner);
+    EXPECT_EQ(2, unpack_integer(store->get("a")));
+    EXPECT_TRUE(unpack_bool(store->get("b")));
+
+    inner = store->savepoint();
+    store->insert("c", mem.create_integer(3));
+    store->commit(inner);
+
+    store->rollback(outer);
+    EXPECT_EQ(1, unpack_integer(store->get("a")));
+    EXPECT_EQ(nullptr, store->get("b"));
+    EXPECT_EQ(nullptr, store->get("c"));
+    EXPECT_THROW(store->rollback(outer), std::runtime_error);
+}
+
+TEST(PersistencyTest, rewritten_key_rolls_back_to_first_value)
+{
+    DummyMemoryManager mem;
+    auto store = make_value<PersistableDictionary>(mem);
+    store->insert("a", mem.create_integer(1));
+
+    auto outer = store->savepoint();
+    for(int64_t i = 0; i < 100; ++i)
+    {
+        auto inner = store->savepoint();
+        store->insert("a", mem.create_integer(i));
+        store->insert("b", mem.create_integer(i));
+        store->commit(inner);
+    }
+
+    EXPECT_EQ(std::set<std::string>({ "a", "b" }), store->changed_keys(outer));
+
+    store->rollback(outer);
+    EXPECT_EQ(1, unpack_integer(store->get("a")));
+    EXPECT_EQ(nullptr, store->get("b"));
+}
+
+TEST(PersistencyTest, encode_and_decode)
+{
+    StorageState storage;
+    storage.m_elements["name"] = std::string("te\0st", 5);
+    storage.m_elements["balance"] = int64_t(-42);
+    storage.m_elements["rate"] = 0.25;
+    storage.m_elements["open"] = true;
+
+    auto data = storage.encode();
+    EXPECT_EQ(StorageState::ENCODING_VERSION, static_cast<uint8_t>(data[0]));
+
+    StorageState decoded;
+    decoded.decode(data);
+    EXPECT_EQ(storage.m_elements, decoded.m_elements);
+
+    // the same contents always encode the same way
+    EXPECT_EQ(data, decoded.encode());
+
+    storage.m_elements["balance"] = int64_t(7);
+    storage.m_elements.erase("open");
+    decoded.decode(storage.encode({ "balance", "open" }));
+    EXPECT_EQ(7, std::get<int64_t>(decoded.m_elements["balance"]));
+    EXPECT_EQ(0, decoded.m_elements.count("open"));
+    EXPECT_EQ(storage.encode(), decoded.encode());
+
+    EXPECT_THROW(decoded.decode(data.substr(0, data.size() - 1)), std::runtime_error);
+}
+
+TEST(PersistencyTest, one_value_per_key)
+{
+    DummyMemoryManager mem;
+    auto store = make_value<PersistableDictionary>(mem);
+
+    store->insert("a", mem.create_boolean(true));
+    store->insert("a", mem.create_integer(1));
+    store->apply("a", mem.create_integer(2), BinaryOpType::Add);
+    EXPECT_EQ(3, unpack_integer(store->get("a")));
+    EXPECT_EQ(1, store->m_elements.size());
+
+    store->remove("a");
+    EXPECT_FALSE(store->has("a"));
+    EXPECT_EQ(nullptr, store->get("a"));
+}
@@ -0,0 +1,86 @@
+#include <cowlang/ProgramCache.h>
+#include <cowlang/cow.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+#include <snappy.h>
+
+namespace cow
+{
+
+class ProgramCacheTest : public ::testing::Test
+{
+};
+
+static std::string compress(const std::string &code)
+{
+    auto raw = compile_string(code).store();
+    std::string compressed;
+    snappy::Compress(raw.data(), raw.size(), &compressed);
+    return compressed;
+}
+
+TEST(ProgramCacheTest, hit_and_miss)
+{
+    ProgramCache cache;
+    auto contract = compress("def default():\n"
+                             "  return 42\n");
+
+    auto first = cache.get(contract);
+    auto second = cache.get(contract);
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1, cache.hits());
+    EXPECT_EQ(1, cache.misses());
+    EXPECT_EQ(1, cache.size());
+
+    DummyMemoryManager mem;
+    Interpreter pyint(second, 0, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ(42, unpack_integer(pyint.calldata(data)));
+}
+
+TEST(ProgramCacheTest, evict_least_recently_used)
+{
+    auto a = compress("def default():\n  return 1\n");
+    auto b = compress("def default():\n  return 2\n");
+    auto c = compress("def default():\n  return 3\n");
+
+    ProgramCache cache;
+    auto program = cache.get(a);
+    auto cost = cache.memory_usage();
+    cache.get(b);
+
+    // room for two programs of about the same size
+    cache.set_budget(cost * 2 + cost / 2);
+    EXPECT_EQ(2, cache.size());
+
+    cache.get(a);
+    cache.get(c);
+    EXPECT_EQ(2, cache.size());
+    EXPECT_LE(cache.memory_usage(), cost * 2 + cost / 2);
+
+    cache.get(a);
+    EXPECT_EQ(2, cache.hits());
+
+    cache.get(b);
+    EXPECT_EQ(4, cache.misses());
+
+    cache.clear();
+    EXPECT_EQ(0, cache.size());
+    EXPECT_EQ(0, cache.memory_usage());
+}
+
+TEST(ProgramCacheTest, corrupt_contract_is_not_cached)
+{
+    auto contract = compress("def default():\n  return 1\n");
+    contract.resize(contract.size() / 2);
+
+    ProgramCache cache;
+    EXPECT_THROW(cache.get(contract), std::runtime_error);
+    EXPECT_EQ(0, cache.size());
+}
+
+} // namespace cow
@@ -0,0 +1,62 @@
+#include <cowlang/cow.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+
+namespace cow
+{
+
+class SnapshotTest : public ::testing::Test
+{
+};
+
+TEST(SnapshotTest, restore)
+{
+    const std::string code = "def get():\n"
+                             "  return 5\n"
+                             "def default():\n"
+                             "  global get\n"
+                             "  get = randint\n"
+                             "  return 1\n"
+                             "from rand import randint\n";
+
+    auto doc = compile_string(code);
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    auto snapshot = pyint.snapshot();
+    ASSERT_NE(nullptr, snapshot);
+    EXPECT_EQ(pyint.num_execution_steps(), snapshot->num_execution_steps());
+
+    std::string data;
+    pyint.calldata(data);
+
+    // the other interpreter still sees the function of the snapshot
+    Interpreter restored(snapshot->program(), 0, mem);
+    restored.set_execution_step_limit(1000);
+    restored.restore(snapshot);
+
+    EXPECT_EQ(snapshot->num_execution_steps(), restored.num_execution_steps());
+    EXPECT_EQ(ValueType::Function, restored.get_scope().get_value("get")->type());
+    EXPECT_EQ(ValueType::Function, restored.get_scope().get_value("randint")->type());
+    EXPECT_EQ(pyint.get_scope().get_value("randint"), pyint.get_scope().get_value("get"));
+    EXPECT_NE(restored.get_scope().get_value("randint"), restored.get_scope().get_value("get"));
+}
+
+TEST(SnapshotTest, only_definitions)
+{
+    auto doc = compile_string("def default():\n"
+                              "  return 1\n"
+                              "x = 1\n");
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+
+    EXPECT_THROW(pyint.execute(), std::runtime_error);
+    EXPECT_EQ(nullptr, pyint.snapshot());
+}
+
+} // namespace cow
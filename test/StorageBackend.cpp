@@ -0,0 +1,93 @@
+#include <cowlang/StorageBackend.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+namespace cow
+{
+
+class StorageBackendTest : public ::testing::Test
+{
+};
+
+TEST(StorageBackendTest, keys_are_loaded_once)
+{
+    StorageState host;
+    host.m_elements["a"] = int64_t(1);
+    host.m_elements["b"] = std::string("x");
+
+    std::vector<std::string> requests;
+    auto backend = std::make_shared<CallbackStorageBackend>([&](const std::string &key) {
+        requests.push_back(key);
+        return host.keys().count(key) ? host.encode({ key }) : std::string();
+    });
+
+    DummyMemoryManager mem;
+    auto store = make_value<PersistableDictionary>(mem);
+    store->set_backend(backend);
+    auto savepoint = store->savepoint();
+
+    EXPECT_EQ(1, unpack_integer(store->get("a")));
+    EXPECT_EQ(nullptr, store->get("c"));
+    store->apply("a", mem.create_integer(2), BinaryOpType::Add);
+    store->insert("b", mem.create_integer(5));
+    EXPECT_EQ(5, unpack_integer(store->get("b")));
+
+    EXPECT_EQ(std::vector<std::string>({ "a", "c", "b" }), requests);
+
+    // the previous value of b was loaded before it was overwritten
+    store->rollback(savepoint);
+    EXPECT_EQ("x", unpack_string(store->get("b")));
+    EXPECT_THROW(store->clear(), std::runtime_error);
+}
+
+TEST(StorageBackendTest, shared_state)
+{
+    StorageState state;
+    state.m_elements["a"] = int64_t(1);
+    state.m_elements["b"] = std::string("x");
+
+    DummyMemoryManager mem;
+    auto store = make_value<PersistableDictionary>(mem);
+    store->set_backend(std::make_shared<StateStorageBackend>(state));
+
+    EXPECT_EQ(1, unpack_integer(store->get("a")));
+    store->insert("c", mem.create_integer(3));
+    store->remove("b");
+
+    // only what was accessed is copied, and the shared state stays as it is
+    EXPECT_EQ(std::set<std::string>({ "a", "c" }), store->keys());
+    EXPECT_EQ(2, state.m_elements.size());
+}
+
+TEST(StorageBackendTest, sorted_file)
+{
+    StorageState storage;
+    for(int i = 0; i < 100; ++i)
+    {
+        storage.m_elements["key" + std::to_string(i)] = int64_t(i);
+    }
+    storage.m_elements["rate"] = 0.5;
+    storage.m_elements["open"] = true;
+
+    auto path = testing::TempDir() + "storage_backend_test";
+    FileStorageBackend::write(path, storage);
+
+    FileStorageBackend backend(path);
+    StorageState loaded;
+    for(auto &key : storage.keys())
+    {
+        backend.load(key, loaded);
+    }
+    EXPECT_EQ(storage.encode(), loaded.encode());
+
+    loaded.m_elements["missing"] = int64_t(1);
+    backend.load("missing", loaded);
+    backend.load("", loaded);
+    backend.load("zzz", loaded);
+    EXPECT_EQ(storage.encode(), loaded.encode());
+
+    remove(path.c_str());
+}
+
+} // namespace cow
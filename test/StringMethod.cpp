@@ -0,0 +1,83 @@
+#include <cowlang/cow.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+
+using namespace cow;
+
+class StringMethodTest : public testing::Test
+{
+};
+
+static std::string run(const std::string &body, uint32_t *num_steps = nullptr)
+{
+    auto doc = compile_string("def default():\n" + body);
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000000);
+    pyint.execute();
+
+    std::string data;
+    auto res = pyint.calldata(data);
+
+    if(num_steps)
+    {
+        *num_steps = pyint.num_execution_steps();
+    }
+
+    return unpack_string(res);
+}
+
+TEST(StringMethodTest, methods)
+{
+    EXPECT_EQ("a-b-c", run("    sep = '-'\n"
+                           "    return sep.join(['a', 'b', 'c'])"));
+    EXPECT_EQ("['a', 'b', '', 'c']", run("    s = 'a,b,,c'\n"
+                                         "    return str(s.split(','))"));
+    EXPECT_EQ("['a', 'b']", run("    s = '  a \\t b '\n"
+                                "    return str(s.split())"));
+    EXPECT_EQ("key:5:{x}", run("    f = '{}:{}:{{x}}'\n"
+                               "    return f.format('key', 5)"));
+    EXPECT_EQ("b a", run("    f = '{1} {0}'\n"
+                         "    return f.format('a', 'b')"));
+    EXPECT_EQ("10", run("    s = 'prefix_key'\n"
+                        "    return str(s.startswith('prefix')) + str(s.startswith('key'))"));
+    EXPECT_EQ("7 -1", run("    s = 'prefix_key'\n"
+                          "    return str(s.find('key')) + ' ' + str(s.find('foo'))"));
+
+    EXPECT_THROW(run("    f = '{} {}'\n"
+                     "    return f.format('a')"),
+                 std::runtime_error);
+}
+
+TEST(StringMethodTest, cost_depends_on_bytes)
+{
+    auto join_steps = [](size_t length) {
+        uint32_t num_steps;
+        run("    s = '" + std::string(length, 'x') + "'\n"
+            "    return s.join(['', ''])",
+            &num_steps);
+        return num_steps;
+    };
+
+    // the result is as long as the separator, each started 32 bytes cost a step
+    EXPECT_EQ(join_steps(1), join_steps(32));
+    EXPECT_EQ(join_steps(1) + 1, join_steps(33));
+}
+
+TEST(StringMethodTest, cost_of_searching)
+{
+    auto steps = [](const std::string &call) {
+        uint32_t num_steps;
+        run("    s = '" + std::string(64, 'x') + "'\n"
+            "    return str(s." + call + ")",
+            &num_steps);
+        return num_steps;
+    };
+
+    // the substring may be compared at every position of the string
+    EXPECT_EQ(steps("find('y')") + 2, steps("find('yy')"));
+    EXPECT_EQ(steps("find('y')") + 6, steps("find('yyyy')"));
+
+    // every part costs a step, splitting at each x gives 65 parts instead of one
+    EXPECT_EQ(steps("split('y')") + 64, steps("split('x')"));
+}
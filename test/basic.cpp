@@ -500,3 +500,47 @@ TEST(BasicTest, pre_set_value)
     auto res = pyint.execute();
     EXPECT_FALSE(unpack_bool(res));
 }
+
+TEST(BasicTest, bitstream_view)
+{
+    bitstream bs;
+    bs << NodeType::Name << std::string("foo") << (int32_t)-3;
+
+    auto buffer = bs.store();
+    bitstream_view view(buffer);
+
+    NodeType type;
+    std::string str;
+    int32_t i = 0;
+    view >> type >> str >> i;
+
+    EXPECT_EQ(NodeType::Name, type);
+    EXPECT_EQ("foo", str);
+    EXPECT_EQ(-3, i);
+    EXPECT_EQ(0, view.remaining());
+    ASSERT_THROW(view >> i, std::runtime_error);
+}
+
+TEST(BasicTest, legacy_bytecode)
+{
+    // programs compiled before the constant pool store their strings inline
+    bitstream body;
+    body << NodeType::Return << NodeType::String << std::string("foo");
+    auto stub = body.store();
+
+    bitstream doc;
+    doc << NodeType::StatementList << (uint32_t)1;
+    doc << NodeType::FunctionDef << NodeType::Name << std::string("default");
+    doc << (uint32_t)stub.size() << NodeType::FunctionStart << (uint32_t)0;
+    doc << NodeType::FunctionStartDefaults << (uint32_t)0 << NodeType::FunctionStartStub;
+    doc.bytecode.write(stub.data(), stub.size());
+    doc << NodeType::FunctionEnd;
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(100);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ("foo", unpack_string(pyint.calldata(data)));
+}
@@ -182,4 +182,109 @@ TEST(Functions, nested_scopes)
     EXPECT_EQ(2, unpack_integer(pyint.execute()));
 }
 
+TEST(Functions, contract_call)
+{
+    const std::string code = "def helper(a, b):\n"
+                             "  return a*b\n"
+                             "def default():\n"
+                             "  x = 0\n"
+                             "  for i in range(5):\n"
+                             "    x += helper(i, 2)\n"
+                             "  return x";
+
+    auto doc = compile_string(code);
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ(20, unpack_integer(pyint.calldata(data)));
+}
+
+TEST(Functions, locals_and_caller_scope)
+{
+    // functions see the variables of their caller
+    const std::string code = "def helper(n):\n"
+                             "  total = 0\n"
+                             "  for i in range(n):\n"
+                             "    total += i\n"
+                             "  return total + offset\n"
+                             "def default():\n"
+                             "  offset = 10\n"
+                             "  return helper(4)";
+
+    auto doc = compile_string(code);
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ(16, unpack_integer(pyint.calldata(data)));
+}
+
+TEST(Functions, builtins_cannot_be_shadowed)
+{
+    const std::string code = "def default():\n"
+                             "  len = 5\n"
+                             "  x = 0\n"
+                             "  for i in range(3):\n"
+                             "    x += len([1, 2]) + max(i, 1)\n"
+                             "  return x";
+
+    auto doc = compile_string(code);
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ(10, unpack_integer(pyint.calldata(data)));
+}
+
+TEST(Functions, recursive_call)
+{
+    const std::string code = "def fib(n):\n"
+                             "  if n < 2:\n"
+                             "    return n\n"
+                             "  return fib(n - 1) + fib(n - 2)\n"
+                             "def default():\n"
+                             "  return fib(12)";
+
+    auto doc = compile_string(code);
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(100000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ(144, unpack_integer(pyint.calldata(data)));
+}
+
+TEST(Functions, duplicate_function)
+{
+    const std::string code = "def square(n):\n"
+                             "  return n * n\n"
+                             "def default():\n"
+                             "  return copy(7)";
+
+    auto doc = compile_string(code);
+
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    auto square = pyint.get_scope().get_value("square");
+    pyint.set_value("copy", square->duplicate());
+
+    std::string data;
+    EXPECT_EQ(49, unpack_integer(pyint.calldata(data)));
+}
+
 } // namespace cow
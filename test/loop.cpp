@@ -168,3 +168,44 @@ TEST(LoopTest, array_loop)
     auto res = pyint.execute();
     EXPECT_EQ(6, unpack_integer(res));
 }
+
+TEST(LoopTest, counter_does_not_alias)
+{
+    // adding to a counter must not change other variables holding the same number
+    const std::string code = "def default():\n"
+                             "  total = 0\n"
+                             "  start = total\n"
+                             "  for i in range(2000):\n"
+                             "    total += i\n"
+                             "  return total + start";
+
+    auto doc = compile_string(code);
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(100000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ(1999000, unpack_integer(pyint.calldata(data)));
+}
+
+TEST(LoopTest, body_assigns_to_function_scope)
+{
+    // loop bodies have no scope of their own, so their variables outlive the iteration
+    const std::string code = "def default():\n"
+                             "  for i in range(3):\n"
+                             "    if i > 0:\n"
+                             "      last += i\n"
+                             "    else:\n"
+                             "      last = 10\n"
+                             "  return last + i";
+
+    auto doc = compile_string(code);
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(1000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ(15, unpack_integer(pyint.calldata(data)));
+}
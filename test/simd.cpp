@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cowlang/cow.h>
+#include <cowlang/simd.h>
+#include <cowlang/unpack.h>
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace cow;
+
+class SimdTest : public testing::Test
+{
+};
+
+TEST(SimdTest, same_as_scalar)
+{
+    using simd::detail::Level;
+
+    std::mt19937_64 random(42);
+
+    // every variant the CPU supports, the scalar one is always there
+    std::vector<const simd::detail::Kernels *> variants;
+    for(auto level : { Level::None, Level::SSE42, Level::AVX2 })
+    {
+        if(auto kernels = simd::detail::kernels(level))
+            variants.push_back(kernels);
+    }
+
+    ASSERT_NE(nullptr, simd::detail::kernels(Level::None));
+
+    for(size_t size = 1; size < 100; ++size)
+    {
+        std::vector<int64_t> values(size);
+        for(auto &value : values)
+        {
+            // a few large values, so the sums overflow
+            value = size % 3 ? int64_t(random() % 200) - 100 : int64_t(random());
+        }
+
+        uint64_t sum = 0;
+        for(auto value : values)
+        {
+            sum += static_cast<uint64_t>(value);
+        }
+
+        auto min = *std::min_element(values.begin(), values.end());
+        auto max = *std::max_element(values.begin(), values.end());
+
+        for(auto kernels : variants)
+        {
+            EXPECT_EQ(min, kernels->min(values.data(), size));
+            EXPECT_EQ(max, kernels->max(values.data(), size));
+            EXPECT_EQ(static_cast<int64_t>(sum), kernels->sum(values.data(), size));
+
+            for(int64_t value = -100; value < 100; ++value)
+            {
+                bool expected = std::find(values.begin(), values.end(), value) != values.end();
+                ASSERT_EQ(expected, kernels->contains(values.data(), size, value));
+            }
+
+            EXPECT_TRUE(kernels->contains(values.data(), size, values.back()));
+        }
+
+        EXPECT_EQ(static_cast<int64_t>(sum), simd::sum(values.data(), size));
+    }
+}
+
+TEST(SimdTest, min_max_of_list)
+{
+    const std::string code = "def default():\n"
+                             "    l = []\n"
+                             "    for i in range(50):\n"
+                             "        l.append((i * 7) % 23)\n"
+                             "    return str(min(l)) + ' ' + str(max(l)) + ' ' + str(22 in l)";
+
+    auto doc = compile_string(code);
+    DummyMemoryManager mem;
+    Interpreter pyint(doc, mem);
+    pyint.set_execution_step_limit(10000);
+    pyint.execute();
+
+    std::string data;
+    EXPECT_EQ("0 22 1", unpack_string(pyint.calldata(data)));
+}
@@ -3,6 +3,7 @@
 #include "pypa/ast/ast.hh"
 #include <cowlang/InterpreterTypes.h>
 #include <cowlang/NodeType.h>
+#include <cstring>
 #include <fstream>
 #include <istream>
 #include <math.h>
@@ -11,6 +12,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <type_traits>
 
 using namespace cow;
 using namespace pypa;
@@ -323,3 +325,96 @@ SERIALIZER_FOR_UINT32TYPE(AstBinOpType)
 SERIALIZER_FOR_UINT32TYPE(AstBoolOpType)
 SERIALIZER_FOR_UINT32TYPE(AstUnaryOpType)
 SERIALIZER_FOR_UINT32TYPE(AstCompareOpType)
+
+/**
+ * Read-only bitstream that views an existing buffer instead of copying it
+ *
+ * Uses the same encoding as bitstream. Reads are bounds-checked against the view and throw
+ * "Unexpected EOF" like bitstream does. The buffer has to outlive the view.
+ */
+class bitstream_view
+{
+public:
+    bitstream_view() = default;
+
+    bitstream_view(const uint8_t *data, uint32_t length) : m_data(data), m_length(length) {}
+
+    explicit bitstream_view(const std::string &data)
+        : bitstream_view(reinterpret_cast<const uint8_t *>(data.data()), data.size())
+    {
+    }
+
+    const uint8_t *data() const { return m_data; }
+
+    uint32_t size() const { return m_length; }
+
+    uint32_t pos() const { return m_pos; }
+
+    uint32_t remaining() const { return m_length - m_pos; }
+
+    bool move_to(uint32_t pos)
+    {
+        if(pos > m_length)
+            return false;
+
+        m_pos = pos;
+        return true;
+    }
+
+    // Integers and floats are stored with their own size, enums always as uint32
+    template <class T> bitstream_view &operator>>(T &v)
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                      "Can only read plain values from a bitstream");
+
+        if constexpr(std::is_enum<T>::value)
+        {
+            uint32_t typus = 0;
+            *this >> typus;
+            v = (T)typus;
+        }
+        else
+        {
+            T raw;
+            memcpy(&raw, fetch(sizeof(T)), sizeof(T));
+            v = EndianSwapper::SwapByte<T, sizeof(T)>::Swap(raw);
+        }
+
+        return *this;
+    }
+
+    bitstream_view &operator>>(std::string &data)
+    {
+        uint32_t length = 0;
+        *this >> length;
+        data.assign(reinterpret_cast<const char *>(fetch(length)), length);
+        return *this;
+    }
+
+    std::string Read(uint32_t count)
+    {
+        return std::string(reinterpret_cast<const char *>(fetch(count)), count);
+    }
+
+    void skip(uint32_t count) { fetch(count); }
+
+    /**
+     * Split off the next count bytes as a view of their own
+     */
+    bitstream_view view(uint32_t count) { return bitstream_view(fetch(count), count); }
+
+private:
+    const uint8_t *fetch(uint32_t count)
+    {
+        if(count > m_length - m_pos)
+            throw std::runtime_error("Unexpected EOF");
+
+        auto ptr = m_data + m_pos;
+        m_pos += count;
+        return ptr;
+    }
+
+    const uint8_t *m_data = nullptr;
+    uint32_t m_length = 0;
+    uint32_t m_pos = 0;
+};